@@ -9,11 +9,8 @@
 
 Matrix::Matrix(const size_t row, const size_t col, const Val initVal) :
         pc2l::Vector<Val>(), rows(row), cols(col) {
-    for (size_t i = 0; i < row; i++) {
-        for(size_t j = 0; j < col; j++) {
-            insert(i, j, initVal);
-        }
-    }
+    // The blocks are filled lazily, without sending each value
+    assign(row * col, initVal);
 }
 
 // Operator to write the matrix to a given output stream
@@ -38,6 +38,7 @@
 //---------------------------------------------------------------------
 
 #include <iostream>
+#include <string>
 #include <pc2l.h>
 
 int main(int argc, char *argv[]) {
@@ -47,10 +48,9 @@ int main(int argc, char *argv[]) {
 
     // Do some testing here.
     std::cout << "world size " << pc2l.worldSize() << std::endl;
-    pc2l::Vector<char*> v;
-    char* data = (char*) "String test";
+    pc2l::Vector<std::string> v;
     for (int i = 0; i < 100; i++) {
-        v.insert(i, data);
+        v.insert(i, "String test " + std::to_string(i));
     }
     for (int i = 0; i < 100; i++) {
         std::cout << "at " << i << " " << v.at(i) << std::endl;
@@ -0,0 +1,454 @@
+#ifndef ALGORITHMS_H
+#define ALGORITHMS_H
+
+//---------------------------------------------------------------------
+//  ____ 
+// |  _ \    This file is part of  PC2L:  A Parallel & Cloud Computing 
+// | |_) |   Library <http://www.pc2lab.cec.miamioh.edu/pc2l>. PC2L is 
+// |  __/    free software: you can  redistribute it and/or  modify it
+// |_|       under the terms of the GNU  General Public License  (GPL)
+//           as published  by  the   Free  Software Foundation, either
+//           version 3 (GPL v3), or  (at your option) a later version.
+//    
+//   ____    PC2L  is distributed in the hope that it will  be useful,
+//  / ___|   but   WITHOUT  ANY  WARRANTY;  without  even  the IMPLIED
+// | |       WARRANTY of  MERCHANTABILITY  or FITNESS FOR A PARTICULAR
+// | |___    PURPOSE.
+//  \____| 
+//            Miami University and  the PC2Lab development team make no
+//            representations  or  warranties  about the suitability of
+//  ____      the software,  either  express  or implied, including but
+// |___ \     not limited to the implied warranties of merchantability,
+//   __) |    fitness  for a  particular  purpose, or non-infringement.
+//  / __/     Miami  University and  its affiliates shall not be liable
+// |_____|    for any damages  suffered by the  licensee as a result of
+//            using, modifying,  or distributing  this software  or its
+//            derivatives.
+//
+//  _         By using or  copying  this  Software,  Licensee  agree to
+// | |        abide  by the intellectual  property laws,  and all other
+// | |        applicable  laws of  the U.S.,  and the terms of the  GNU
+// | |___     General  Public  License  (version 3).  You  should  have
+// |_____|    received a  copy of the  GNU General Public License along
+//            with MUSE.  If not,  you may  download  copies  of GPL V3
+//            from <http://www.gnu.org/licenses/>.
+//
+// --------------------------------------------------------------------
+// Authors:   Dhananjai M. Rao          raodm@miamioh.edu
+//---------------------------------------------------------------------
+/**
+ * @file Algorithms.h
+ * @brief Definition of algorithms that run on the CacheWorkers, close
+ * to the data, instead of moving the data to the manager.
+ * @version 0.1
+ * @date 2022-05-02
+ *
+ * Each algorithm runs a kernel that must be registered (using one of
+ * the register methods below) on all processes, in the same order,
+ * before System::start() is called.  For example:
+ *
+ * \code
+ * const int square = pc2l::registerTransform<int>([](int x) { return x * x; });
+ * const int sum    = pc2l::registerReduce<int>(std::plus<int>());
+ * const int isNeg  = pc2l::registerPredicate<int>([](int x) { return x < 0; });
+ * pc2l.start();
+ * ...
+ * pc2l::transform(vec, square);
+ * const int total = pc2l::reduce(vec, 0, sum);
+ * const bool neg  = pc2l::any_of(vec, isNeg);
+ * \endcode
+ */
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include "Kernel.h"
+#include "System.h"
+#include "Vector.h"
+
+BEGIN_NAMESPACE(pc2l);
+
+/**
+ * A kernel that replaces each value x with op(x).
+ *
+ * @tparam T the type of values
+ * @tparam Op the type of the operation, callable as T op(const T&)
+ */
+template <typename T, typename Op>
+class TransformKernel : public Kernel {
+public:
+    explicit TransformKernel(Op op) : op(op) {}
+    int valueSize() const override { return sizeof(T); }
+    bool modifiesValues() const override { return true; }
+    void apply(char* values, int count, char*, bool&) override {
+        T* vals = reinterpret_cast<T*>(values);
+        std::transform(vals, vals + count, vals, op);
+    }
+
+private:
+    /** The operation applied to each value */
+    Op op;
+};
+
+/**
+ * A kernel that calls op(x) for each value x, where op may modify
+ * x in place.
+ *
+ * @tparam T the type of values
+ * @tparam Op the type of the operation, callable as op(T&)
+ */
+template <typename T, typename Op>
+class ForEachKernel : public Kernel {
+public:
+    explicit ForEachKernel(Op op) : op(op) {}
+    int valueSize() const override { return sizeof(T); }
+    bool modifiesValues() const override { return true; }
+    void apply(char* values, int count, char*, bool&) override {
+        T* vals = reinterpret_cast<T*>(values);
+        std::for_each(vals, vals + count, op);
+    }
+
+private:
+    /** The operation called for each value */
+    Op op;
+};
+
+/**
+ * A kernel that combines all values into one value with op.
+ *
+ * @tparam T the type of values
+ * @tparam Op the type of the operation, callable as T op(const T&,
+ * const T&).  It must be associative and commutative, because
+ * values are combined in no particular order.
+ */
+template <typename T, typename Op>
+class ReduceKernel : public Kernel {
+public:
+    explicit ReduceKernel(Op op) : op(op) {}
+    int valueSize() const override { return sizeof(T); }
+    int resultSize() const override { return sizeof(T); }
+    bool modifiesValues() const override { return false; }
+    void apply(char* values, int count, char* result, bool& hasResult) override {
+        const T* vals = reinterpret_cast<const T*>(values);
+        T& acc = *reinterpret_cast<T*>(result);
+        if (!hasResult && count > 0) {
+            acc = *vals++;
+            count--;
+            hasResult = true;
+        }
+        acc = std::accumulate(vals, vals + count, acc, op);
+    }
+    void combine(char* result, const char* partial) const override {
+        T& acc = *reinterpret_cast<T*>(result);
+        acc = op(acc, *reinterpret_cast<const T*>(partial));
+    }
+
+private:
+    /** The operation used to combine values */
+    Op op;
+};
+
+/**
+ * A kernel that orders values with a comparator, for sort().  When
+ * used with transform(), it sorts the values in each block.
+ *
+ * @tparam T the type of values
+ * @tparam Compare the type of the comparator, callable as bool
+ * comp(const T&, const T&)
+ */
+template <typename T, typename Compare>
+class SortKernel : public Kernel {
+public:
+    explicit SortKernel(Compare comp) : comp(comp) {}
+    int valueSize() const override { return sizeof(T); }
+    bool modifiesValues() const override { return true; }
+    bool ordersValues() const override { return true; }
+    void apply(char* values, int count, char*, bool&) override {
+        sort(values, count);
+    }
+    bool less(const char* a, const char* b) const override {
+        return comp(*reinterpret_cast<const T*>(a), *reinterpret_cast<const T*>(b));
+    }
+    void sort(char* values, long long count) const override {
+        T* vals = reinterpret_cast<T*>(values);
+        std::sort(vals, vals + count, comp);
+    }
+
+private:
+    /** The comparator used to order values */
+    Compare comp;
+};
+
+/**
+ * A kernel that tests values with a predicate, for find_if(),
+ * count_if(), and any_of().
+ *
+ * @tparam T the type of values
+ * @tparam Pred the type of the predicate, callable as bool pred(const T&)
+ */
+template <typename T, typename Pred>
+class PredicateKernel : public Kernel {
+public:
+    explicit PredicateKernel(Pred pred) : pred(pred) {}
+    int valueSize() const override { return sizeof(T); }
+    bool modifiesValues() const override { return false; }
+    void apply(char*, int, char*, bool&) override {}
+    bool testsValues() const override { return true; }
+    bool test(const char* value) const override {
+        T val;
+        // values in a block may not be aligned for T
+        std::copy_n(value, sizeof(T), reinterpret_cast<char*>(&val));
+        return pred(val);
+    }
+
+private:
+    /** The predicate used to test values */
+    Pred pred;
+};
+
+/**
+ * Register a kernel for transform().  See the notes at the top of
+ * this file.
+ * @tparam T the type of values in the vectors to be transformed
+ * @param op the operation, callable as T op(const T&)
+ * @return the id of the kernel
+ */
+template <typename T, typename Op>
+int registerTransform(Op op) {
+    return System::get().registerKernel(new TransformKernel<T, Op>(op));
+}
+
+/**
+ * Register a kernel for for_each().  See the notes at the top of
+ * this file.
+ * @tparam T the type of values in the vectors to be processed
+ * @param op the operation, callable as op(T&)
+ * @return the id of the kernel
+ */
+template <typename T, typename Op>
+int registerForEach(Op op) {
+    return System::get().registerKernel(new ForEachKernel<T, Op>(op));
+}
+
+/**
+ * Register a kernel for reduce().  See the notes at the top of
+ * this file.
+ * @tparam T the type of values in the vectors to be reduced
+ * @param op the associative and commutative operation, callable as
+ * T op(const T&, const T&)
+ * @return the id of the kernel
+ */
+template <typename T, typename Op>
+int registerReduce(Op op) {
+    return System::get().registerKernel(new ReduceKernel<T, Op>(op));
+}
+
+/**
+ * Register a kernel for sort().  See the notes at the top of this
+ * file.
+ * @tparam T the type of values in the vectors to be sorted
+ * @param comp the comparator, callable as bool comp(const T&, const T&)
+ * @return the id of the kernel
+ */
+template <typename T, typename Compare = std::less<T>>
+int registerSort(Compare comp = Compare()) {
+    return System::get().registerKernel(new SortKernel<T, Compare>(comp));
+}
+
+/**
+ * Register a kernel for find_if(), count_if(), and any_of().  See
+ * the notes at the top of this file.
+ * @tparam T the type of values in the vectors to be searched
+ * @param pred the predicate, callable as bool pred(const T&)
+ * @return the id of the kernel
+ */
+template <typename T, typename Pred>
+int registerPredicate(Pred pred) {
+    return System::get().registerKernel(new PredicateKernel<T, Pred>(pred));
+}
+
+/**
+ * Obtain a kernel and check that it can be run on values of type T
+ * @param id the id of the kernel
+ * @param hasResult true if the kernel must produce a result
+ * @return the kernel with the given id
+ */
+template <typename T>
+Kernel& checkedKernel(int id, bool hasResult) {
+    static_assert(!std::is_same<T, bool>::value,
+                  "Kernels cannot run on the packed bits of Vector<bool>");
+    Kernel& kernel = System::get().getKernel(id);
+    if (kernel.valueSize() != sizeof(T) ||
+        (hasResult && kernel.resultSize() != sizeof(T))) {
+        throw PC2L_EXP("Kernel %d cannot be used for values of size %zu",
+                       "Check the type the kernel was registered for", id,
+                       sizeof(T));
+    }
+    return kernel;
+}
+
+/**
+ * Replace each value x in \p vec with op(x), where op is the
+ * operation of a kernel registered with registerTransform().  The
+ * values are transformed on the workers that hold them.
+ * @param vec the vector to be transformed
+ * @param kernel the id of the kernel
+ */
+template <typename T, unsigned long long E>
+void transform(Vector<T, E, true>& vec, int kernel) {
+    checkedKernel<T>(kernel, false);
+    vec.flush();
+    System::get().cacheManager().compute(vec.dsTag, kernel, vec.size(),
+                                         vec.valuesPerBlock(), nullptr);
+}
+
+/**
+ * Call op(x) for each value x in \p vec, where op is the operation
+ * of a kernel registered with registerForEach().  The operation is
+ * run on the workers that hold the values.
+ * @param vec the vector to be processed
+ * @param kernel the id of the kernel
+ */
+template <typename T, unsigned long long E>
+void for_each(Vector<T, E, true>& vec, int kernel) {
+    transform(vec, kernel);
+}
+
+/**
+ * Combine \p init and all the values in \p vec with op, where op is
+ * the operation of a kernel registered with registerReduce().  Each
+ * worker combines the values it holds and only the partial results
+ * are sent to the manager.
+ * @param vec the vector to be reduced
+ * @param init the initial value
+ * @param kernel the id of the kernel
+ * @return the result of the reduction
+ */
+template <typename T, unsigned long long E>
+T reduce(Vector<T, E, true>& vec, T init, int kernel) {
+    Kernel& reducer = checkedKernel<T>(kernel, true);
+    vec.flush();
+    T result;
+    if (System::get().cacheManager().compute(vec.dsTag, kernel, vec.size(),
+                                             vec.valuesPerBlock(),
+                                             reinterpret_cast<char*>(&result))) {
+        reducer.combine(reinterpret_cast<char*>(&init),
+                        reinterpret_cast<const char*>(&result));
+    }
+    return init;
+}
+
+/**
+ * Sort the values in \p vec using the comparator of a kernel
+ * registered with registerSort().  The values are sorted on the
+ * workers with a parallel sample sort (see CacheManager::sort()),
+ * without moving them through the manager.
+ * @param vec the vector to be sorted
+ * @param kernel the id of the kernel
+ */
+template <typename T, unsigned long long E>
+void sort(Vector<T, E, true>& vec, int kernel) {
+    if (!checkedKernel<T>(kernel, false).ordersValues()) {
+        throw PC2L_EXP("Kernel %d does not order values",
+                       "Use a kernel registered with registerSort()", kernel);
+    }
+    vec.flush();
+    if (vec.size() > 0) {
+        System::get().cacheManager().sort(vec.dsTag, kernel, vec.size(),
+                                          vec.valuesPerBlock());
+    }
+}
+
+/**
+ * Search the values in \p vec on the workers that hold them (see
+ * CacheManager::search()).
+ * @param vec the vector to be searched
+ * @param kernel the id of a kernel registered with
+ * registerPredicate(), or -1 to compare values with \p value
+ * @param value the value to be compared with, if kernel is -1
+ * @param findFirst if true, find the first match. Otherwise, count
+ * the matches.
+ * @return the index of the first match (or vec.size() if there is
+ * none), or the number of matches
+ */
+template <typename T, unsigned long long E>
+unsigned long long search(Vector<T, E, true>& vec, int kernel, const T& value,
+                          bool findFirst) {
+    if (kernel >= 0 && !checkedKernel<T>(kernel, false).testsValues()) {
+        throw PC2L_EXP("Kernel %d does not test values",
+                       "Use a kernel registered with registerPredicate()", kernel);
+    }
+    vec.flush();
+    if (vec.size() == 0) {
+        return 0;
+    }
+    return System::get().cacheManager().search(
+        vec.dsTag, kernel, vec.size(), vec.valuesPerBlock(),
+        reinterpret_cast<const char*>(&value), sizeof(T), findFirst);
+}
+
+/**
+ * Find the first value in \p vec that is equal to \p value.  The
+ * values are compared on the workers that hold them, and each worker
+ * stops at its first match, so only indices are sent to the manager.
+ * @param vec the vector to be searched
+ * @param value the value to be found (bytewise equality)
+ * @return the index of the first match, or vec.size() if there is none
+ */
+template <typename T, unsigned long long E, typename U>
+unsigned long long find(Vector<T, E, true>& vec, const U& value) {
+    return search(vec, -1, T(value), true);
+}
+
+/**
+ * Find the first value in \p vec that satisfies the predicate of a
+ * kernel registered with registerPredicate() (see find()).
+ * @param vec the vector to be searched
+ * @param kernel the id of the kernel
+ * @return the index of the first match, or vec.size() if there is none
+ */
+template <typename T, unsigned long long E>
+unsigned long long find_if(Vector<T, E, true>& vec, int kernel) {
+    return search(vec, kernel, T(), true);
+}
+
+/**
+ * Count the values in \p vec that are equal to \p value.  Each
+ * worker counts the values it holds and only the counts are sent to
+ * the manager.
+ * @param vec the vector to be searched
+ * @param value the value to be counted (bytewise equality)
+ * @return the number of values equal to \p value
+ */
+template <typename T, unsigned long long E, typename U>
+unsigned long long count(Vector<T, E, true>& vec, const U& value) {
+    return search(vec, -1, T(value), false);
+}
+
+/**
+ * Count the values in \p vec that satisfy the predicate of a kernel
+ * registered with registerPredicate() (see count()).
+ * @param vec the vector to be searched
+ * @param kernel the id of the kernel
+ * @return the number of values satisfying the predicate
+ */
+template <typename T, unsigned long long E>
+unsigned long long count_if(Vector<T, E, true>& vec, int kernel) {
+    return search(vec, kernel, T(), false);
+}
+
+/**
+ * Determine if any value in \p vec satisfies the predicate of a
+ * kernel registered with registerPredicate() (see find_if()).
+ * @param vec the vector to be searched
+ * @param kernel the id of the kernel
+ * @return true if at least one value satisfies the predicate
+ */
+template <typename T, unsigned long long E>
+bool any_of(Vector<T, E, true>& vec, int kernel) {
+    return find_if(vec, kernel) < vec.size();
+}
+
+END_NAMESPACE(pc2l);
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef BLOCK_CODEC_H
+#define BLOCK_CODEC_H
+
+//---------------------------------------------------------------------
+//  ____ 
+// |  _ \    This file is part of  PC2L:  A Parallel & Cloud Computing 
+// | |_) |   Library <http://www.pc2lab.cec.miamioh.edu/pc2l>. PC2L is 
+// |  __/    free software: you can  redistribute it and/or  modify it
+// |_|       under the terms of the GNU  General Public License  (GPL)
+//           as published  by  the   Free  Software Foundation, either
+//           version 3 (GPL v3), or  (at your option) a later version.
+//    
+//   ____    PC2L  is distributed in the hope that it will  be useful,
+//  / ___|   but   WITHOUT  ANY  WARRANTY;  without  even  the IMPLIED
+// | |       WARRANTY of  MERCHANTABILITY  or FITNESS FOR A PARTICULAR
+// | |___    PURPOSE.
+//  \____| 
+//            Miami University and  the PC2Lab development team make no
+//            representations  or  warranties  about the suitability of
+//  ____      the software,  either  express  or implied, including but
+// |___ \     not limited to the implied warranties of merchantability,
+//   __) |    fitness  for a  particular  purpose, or non-infringement.
+//  / __/     Miami  University and  its affiliates shall not be liable
+// |_____|    for any damages  suffered by the  licensee as a result of
+//            using, modifying,  or distributing  this software  or its
+//            derivatives.
+//
+//  _         By using or  copying  this  Software,  Licensee  agree to
+// | |        abide  by the intellectual  property laws,  and all other
+// | |        applicable  laws of  the U.S.,  and the terms of the  GNU
+// | |___     General  Public  License  (version 3).  You  should  have
+// |_____|    received a  copy of the  GNU General Public License along
+//            with MUSE.  If not,  you may  download  copies  of GPL V3
+//            from <http://www.gnu.org/licenses/>.
+//
+// --------------------------------------------------------------------
+// Authors:   Dhananjai M. Rao          raodm@miamioh.edu
+//---------------------------------------------------------------------
+/**
+ * @file BlockCodec.h
+ * @brief Definition of BlockCodec, the interface of the compression
+ * schemes used for the blocks held by the CacheWorkers.
+ * @version 0.1
+ * @date 2022-05-18
+ */
+
+#include <vector>
+#include "Message.h"
+
+BEGIN_NAMESPACE(pc2l);
+
+/**
+ * The interface of a compression scheme (or codec) for the payload of
+ * blocks.  A codec is chosen per data structure (see
+ * Vector::setCodec()).  The CacheManager encodes the blocks of the
+ * data structure when they are sent to (or evicted to) the
+ * CacheWorkers, which store them encoded.  Blocks are decoded when
+ * they are fetched back into the CacheManager, or when a worker
+ * operates on them in place (in which case the worker keeps the
+ * decoded block).
+ *
+ * Encoded blocks are sent as ENCODED_BLOCK messages whose payload
+ * starts with a Header identifying the codec, so that any process
+ * can decode them.  The built-in codecs are identified by the
+ * BuiltIn enumeration and other codecs can be registered via
+ * System::registerCodec().
+ */
+class BlockCodec {
+public:
+    /**
+     * The codecs that are always available.
+     */
+    enum BuiltIn : int {
+        NONE = -1,       /**< Blocks are stored as-is */
+        DELTA = 0,       /**< Delta + frame-of-reference bit-packing for integers */
+        SHUFFLE_RLE,     /**< Byte shuffling + run-length encoding for floats */
+        BUILT_IN_COUNT   /**< Number of built-in codecs */
+    };
+
+    /**
+     * The information at the start of the payload of an
+     * ENCODED_BLOCK message.
+     */
+    struct Header {
+        /** The id of the codec used to encode the block */
+        int codec;
+        /** The size (in bytes) of the values in the block */
+        int valueSize;
+        /** The size (in bytes) of the decoded block */
+        int blockSize;
+    };
+
+    /**
+     * The polymorphic destructor.
+     */
+    virtual ~BlockCodec() {}
+
+    /**
+     * Encode the payload of a block.
+     *
+     * \param[in] block The payload of the block to be encoded.
+     *
+     * \param[in] size The size (in bytes) of the payload.
+     *
+     * \param[in] valueSize The size (in bytes) of each value in the
+     * block. Any bytes after the last whole value are to be
+     * preserved as well.
+     *
+     * \param[out] out The encoded bytes are appended to this buffer.
+     *
+     * \return false if the block cannot be encoded by this codec, in
+     * which case it is stored as-is.
+     */
+    virtual bool encode(const char* block, int size, int valueSize,
+                        std::vector<char>& out) const = 0;
+
+    /**
+     * Decode the payload of a block encoded by encode().
+     *
+     * \param[in] data The encoded bytes.
+     *
+     * \param[in] size The number of encoded bytes.
+     *
+     * \param[in] valueSize The size (in bytes) of each value.
+     *
+     * \param[out] block The buffer to hold the decoded payload.
+     *
+     * \param[in] blockSize The size (in bytes) of the decoded payload.
+     */
+    virtual void decode(const char* data, int size, int valueSize,
+                        char* block, int blockSize) const = 0;
+
+    /**
+     * Encode a block using the given codec.  Blocks that do not
+     * shrink are returned as-is.
+     *
+     * \param[in] block The STORE_BLOCK message to be encoded.
+     *
+     * \param[in] codec The id of the codec to be used.
+     *
+     * \param[in] valueSize The size (in bytes) of the values in the
+     * block.
+     *
+     * \return An ENCODED_BLOCK message with the same tags as \c block,
+     * or \c block itself.
+     */
+    static MessagePtr encodeBlock(const MessagePtr& block, int codec,
+                                  int valueSize);
+
+    /**
+     * Decode a block encoded by encodeBlock().
+     *
+     * \param[in] msg The ENCODED_BLOCK message to be decoded.
+     *
+     * \return A STORE_BLOCK message with the same tags as \c msg.
+     */
+    static MessagePtr decodeBlock(const MessagePtr& msg);
+};
+
+/**
+ * The codec for blocks of signed integers (of 1, 2, 4, or 8 bytes).
+ * The differences between successive values are stored relative to
+ * the smallest difference (frame of reference), using just as many
+ * bits as the largest one needs.  Sorted or slowly varying values
+ * need just a few bits each.
+ */
+class DeltaCodec : public BlockCodec {
+public:
+    bool encode(const char* block, int size, int valueSize,
+                std::vector<char>& out) const override;
+    void decode(const char* data, int size, int valueSize,
+                char* block, int blockSize) const override;
+};
+
+/**
+ * The codec for blocks of floating point values (or other values
+ * whose bytes vary independently).  The bytes of the values are
+ * shuffled so that the n-th bytes of all the values are adjacent,
+ * grouping the sign/exponent bytes (which rarely vary) together.
+ * The shuffled bytes are run-length encoded.
+ */
+class ShuffleRleCodec : public BlockCodec {
+public:
+    bool encode(const char* block, int size, int valueSize,
+                std::vector<char>& out) const override;
+    void decode(const char* data, int size, int valueSize,
+                char* block, int blockSize) const override;
+};
+
+END_NAMESPACE(pc2l);
+
+#endif
@@ -49,6 +49,7 @@
  */
 // namespace pc2l {
 #include <queue>
+#include <unordered_set>
 BEGIN_NAMESPACE(pc2l);
 
 /**
@@ -61,6 +62,16 @@ BEGIN_NAMESPACE(pc2l);
  */
 class CacheManager : public CacheWorker {
 public:
+    /**
+     * The policies for writing modified blocks to the workers that
+     * own them (see setWritePolicy()).
+     */
+    enum WritePolicy : int {
+        WRITE_BACK = 1, /**< Changes are sent when the block is evicted */
+        WRITE_THROUGH,  /**< Changes are sent right away, keeping the block cached */
+        WRITE_AROUND    /**< Changes are sent right away, without caching the block */
+    };
+
     /**
      * The default constructor.  Currently, the constructor does not
      * have much to do but is present for future extensions.
@@ -90,12 +101,352 @@ public:
     void finalize() override;
 
     /**
-     * Retrieve a block from the manager cache
+     * Retrieve a block from the manager cache.  If the block has been
+     * requested from a worker (e.g., by the prefetcher) but has not
+     * arrived yet, this method waits for it to arrive.
      * @param key the key of a given block calculated via block and DS tag
      * @return message associated with @param key
      */
     MessagePtr getBlock(size_t key);
 
+    /**
+     * Retrieve a block from the manager cache, fetching it from the
+     * worker that owns it (and adding it to the cache) if needed.
+     * @param dsTag tag of the data structure the block belongs to
+     * @param blockTag tag of the block to be retrieved
+     * @return message associated with the block
+     */
+    MessagePtr fetchBlock(unsigned int dsTag, size_t blockTag);
+
+    /**
+     * Request a block from the worker that owns it without waiting
+     * for it to arrive.  The block is added to the cache when it
+     * arrives.  Blocks that are already in the cache or that have
+     * already been requested are not requested again.
+     * @param dsTag tag of the data structure the block belongs to
+     * @param blockTag tag of the block to be requested
+     */
+    void requestBlock(unsigned int dsTag, size_t blockTag);
+
+    /**
+     * Check, without waiting, if a block requested earlier (see
+     * requestBlock()) has arrived.  Blocks that have arrived are
+     * added to the cache.
+     * @param dsTag tag of the data structure the block belongs to
+     * @param blockTag tag of the block
+     * @return true if the block is no longer outstanding
+     */
+    bool pollBlock(unsigned int dsTag, size_t blockTag);
+
+    /**
+     * Read values from arbitrary positions in the blocks of a data
+     * structure.  Values in blocks that are in the cache are copied
+     * locally.  The others are bucketed by the worker owning their
+     * block and each worker is sent one GATHER message listing its
+     * values, replying with just those values (see
+     * CacheWorker::gatherValues()), rather than whole blocks.  The
+     * requests to all the workers are in flight at the same time.
+     * @param dsTag tag of the data structure to be read
+     * @param locations the (blockTag, byte offset) of each value
+     * @param valueSize the size (in bytes) of each value
+     * @param out buffer with room for all the values, in the order
+     * of \p locations
+     */
+    void gatherValues(unsigned int dsTag,
+                      const std::vector<std::pair<size_t, size_t>>& locations,
+                      int valueSize, char* out);
+
+    /**
+     * Write values to arbitrary positions in the blocks of a data
+     * structure (see gatherValues()).  Values in blocks that are in
+     * the cache (or are about to arrive in it) are written locally.
+     * Each worker is sent one SCATTER message, without waiting, with
+     * the values for the blocks it owns (see
+     * CacheWorker::scatterValues()).
+     * @param dsTag tag of the data structure to be written
+     * @param locations the (blockTag, byte offset) of each value
+     * @param valueSize the size (in bytes) of each value
+     * @param values the values, in the order of \p locations
+     */
+    void scatterValues(unsigned int dsTag,
+                       const std::vector<std::pair<size_t, size_t>>& locations,
+                       int valueSize, const char* values);
+
+    /**
+     * Overwrite \p len bytes of a block, starting at byte \p offset,
+     * with \p data.  If the block is in the cache (or is about to
+     * arrive in it), the cached copy is modified.  Otherwise, a
+     * PATCH_BLOCK message is sent, without waiting, to the worker
+     * that owns the block, so that the block is not fetched at all
+     * (see CacheWorker::patchCacheBlock()).
+     * @param dsTag tag of the data structure the block belongs to
+     * @param blockTag tag of the block to be modified
+     * @param offset the byte offset in the block
+     * @param data the bytes to be written
+     * @param len the number of bytes to be written
+     */
+    void patchBlock(unsigned int dsTag, size_t blockTag, unsigned int offset,
+                    const char* data, unsigned int len);
+
+    /**
+     * Send a block to the worker that owns it, without adding it to
+     * the cache and without waiting for the send to complete.  Up to
+     * storeDepth sends per worker are kept in flight, so that blocks
+     * are streamed to all the workers concurrently.
+     * @param msg the STORE_BLOCK message with the block. It must not
+     * be modified after this call.
+     */
+    void streamBlock(const MessagePtr& msg);
+
+    /**
+     * Add a block that was modified by the manager to the cache (or
+     * refer to it if it is already cached), recording that bytes
+     * [offset, offset + len) of its payload were modified.  Only the
+     * modified ranges are written back when the block is evicted
+     * (see writeDirtyRanges()), while blocks that were just read are
+     * not written back at all.  The write policy of the data
+     * structure (see setWritePolicy()) may write the changes right
+     * away instead.
+     * @param block the modified block
+     * @param offset offset (in bytes) of the modified range
+     * @param len the number of bytes modified
+     */
+    void markDirty(const MessagePtr& block, unsigned int offset, unsigned int len);
+
+    /**
+     * Add a block that was modified by the manager to the cache,
+     * recording that the whole block was modified.  Blocks created
+     * by the manager (which the workers do not hold yet) must be
+     * added this way, so that they are written back in full.
+     * @param block the modified block
+     */
+    void markDirty(const MessagePtr& block) {
+        markDirty(block, 0, block->getPayloadSize());
+    }
+
+    /**
+     * Add a block that is about to be modified in place by the
+     * caller to the cache, recording that the whole block is
+     * modified.  Since the changes cannot be observed (e.g., writes
+     * through a Vector iterator) they are written back when the
+     * block is evicted or written back, whatever the write policy of
+     * the data structure (see setWritePolicy()).  While the caller
+     * still holds the block, it stays dirty after being written
+     * back, since it may be modified again.
+     * @param block the block that is about to be modified
+     */
+    void markWritable(const MessagePtr& block);
+
+    /**
+     * Choose the codec used to compress the blocks of a data
+     * structure when they are sent to the workers (see BlockCodec).
+     * Blocks received from the workers are decoded as they arrive.
+     * The codec is kept when the blocks of the data structure are
+     * dropped and is copied along with them (see cloneDataStructure()).
+     * @param dsTag tag of the data structure
+     * @param codec one of BlockCodec::BuiltIn or the id of a codec
+     * registered via System::registerCodec(). BlockCodec::NONE stores
+     * the blocks as-is.
+     * @param valueSize the size (in bytes) of the values in the blocks
+     */
+    void setCodec(unsigned int dsTag, int codec, int valueSize);
+
+    /**
+     * Choose how the changes to the blocks of a data structure (see
+     * markDirty()) reach the workers.  WRITE_BACK (the default)
+     * sends them when blocks are evicted, so repeated changes to a
+     * block cost one message.  WRITE_THROUGH sends them right away,
+     * so that the workers (and thus kernels run by them) always see
+     * the latest values.  WRITE_AROUND also sends them right away
+     * but removes the blocks from the cache, so that writing many
+     * blocks (e.g., loading data) does not evict the blocks in use.
+     * Like the codec, the policy is kept when the blocks are dropped
+     * and is copied along with them.
+     * @param dsTag tag of the data structure
+     * @param policy the write policy
+     */
+    void setWritePolicy(unsigned int dsTag, WritePolicy policy);
+
+    /**
+     * Lazily fill the blocks [firstBlock, lastBlock) of a data
+     * structure with copies of a value.  Cached copies of these blocks
+     * are discarded and a FILL_BLOCK message is sent to each worker.
+     * The workers create the blocks only when they are first
+     * requested (see CacheWorker::fillCacheBlocks()).  Hence, filling
+     * any number of blocks costs one small message per worker.
+     * @param dsTag tag of the data structure the blocks belong to
+     * @param firstBlock the first block to be filled
+     * @param lastBlock one past the last block to be filled
+     * @param blockSize the size (in bytes) of each block
+     * @param value the bytes of the value to be repeated in each block
+     * @param valueSize the size (in bytes) of the value
+     */
+    void fillBlocks(unsigned int dsTag, size_t firstBlock, size_t lastBlock,
+                    size_t blockSize, const char* value, int valueSize);
+
+    /**
+     * Free all the blocks of a data structure.  The blocks in the
+     * manager's cache are discarded (without writing them back) and
+     * a DROP_DS message is sent to each worker so that the workers
+     * free the blocks they hold (see CacheWorker::dropDataStructure()).
+     * @param dsTag tag of the data structure to be dropped
+     */
+    void dropDataStructure(unsigned int dsTag);
+
+    /**
+     * Copy all the blocks of a data structure into another (empty)
+     * data structure.  The blocks in the manager's cache are written
+     * back first and a CLONE_DS message is sent to each worker so
+     * that the workers copy the blocks they hold (see
+     * CacheWorker::cloneDataStructure()).
+     * @param srcDs tag of the data structure to be copied
+     * @param destDs tag of the data structure receiving the copies
+     */
+    void cloneDataStructure(unsigned int srcDs, unsigned int destDs);
+
+    /**
+     * Write all the blocks of a data structure to files in a
+     * directory.  The blocks in the manager's cache are written back
+     * first and a SAVE_DS message is sent to each worker, so that the
+     * workers write the blocks they own to their own file in parallel
+     * (see CacheWorker::saveDataStructure()).  The manager writes
+     * the number of workers and \p info (the state of the data
+     * structure that is not held in blocks) to the directory as well.
+     * An exception is thrown if any process fails.
+     * @param dsTag tag of the data structure to be saved
+     * @param dir the directory, local to each process, to write to
+     * @param blockCount the number of blocks in the data structure
+     * @param info the state of the data structure, returned by
+     * openDataStructure()
+     */
+    void saveDataStructure(unsigned int dsTag, const std::string& dir,
+                           size_t blockCount, const std::string& info);
+
+    /**
+     * Use the blocks saved in a directory (see saveDataStructure())
+     * as the blocks of an empty data structure.  An OPEN_DS message
+     * is sent to each worker so that the workers map their file into
+     * memory (see CacheWorker::openDataStructure()).  An exception is
+     * thrown if any process fails, or if the blocks were saved with a
+     * different number of workers.
+     * @param dsTag tag of the data structure receiving the blocks
+     * @param dir the directory the blocks were saved to
+     * @return the info passed to saveDataStructure()
+     */
+    std::string openDataStructure(unsigned int dsTag, const std::string& dir);
+
+    /**
+     * Run a registered kernel (see Kernel) on the workers, over all
+     * the blocks of a data structure.  Blocks in the manager's cache
+     * are written back to the workers first, so that the kernel sees
+     * the latest values.  If the kernel modifies values, the cached
+     * copies are discarded as well.  The partial results from the
+     * workers are then combined into one result.
+     * @param dsTag tag of the data structure to be processed
+     * @param kernelId the id of the kernel to be run
+     * @param count the number of values in the data structure
+     * @param perBlock the number of values in each block
+     * @param result buffer for the result (if the kernel has one)
+     * @return true if result holds a result, i.e., the kernel
+     * produces results and the data structure is not empty
+     */
+    bool compute(unsigned int dsTag, int kernelId, unsigned long long count,
+                 unsigned long long perBlock, char* result);
+
+    /**
+     * Find or count the values of a data structure that satisfy a
+     * predicate, on the workers (see CacheWorker::searchBlocks()).
+     * Blocks in the manager's cache are written back to the workers
+     * first.  Only the partial results are sent back by the workers.
+     * @param dsTag tag of the data structure to be searched
+     * @param kernelId the id of the predicate kernel, or -1 to compare
+     * values with \p value
+     * @param count the number of values in the data structure
+     * @param perBlock the number of values in each block
+     * @param value the bytes of the value to be compared with (if
+     * kernelId is -1)
+     * @param valueSize the size (in bytes) of each value
+     * @param findFirst if true, find the first match. Otherwise,
+     * count the matches.
+     * @return the index of the first match (or \p count if there is
+     * none), or the number of matches
+     */
+    unsigned long long search(unsigned int dsTag, int kernelId,
+                              unsigned long long count, unsigned long long perBlock,
+                              const char* value, int valueSize, bool findFirst);
+
+    /**
+     * Sort the values of a data structure on the workers using a
+     * parallel sample sort, ordering values with a registered kernel
+     * (see Kernel::ordersValues()).  Blocks in the manager's cache
+     * are written back to the workers and discarded first.  The sort
+     * proceeds in steps (see CacheWorker::sortBlocks()):
+     * <ol>
+     * <li>Each worker sorts the values in the blocks it owns and
+     * sends back evenly spaced samples.</li>
+     * <li>The manager sorts the samples and picks one splitter per
+     * worker (except the first), dividing values into one bucket per
+     * worker.  Each worker reports the number of its values in each
+     * bucket.</li>
+     * <li>From these counts, the manager computes where each bucket
+     * starts in the sorted data structure.  The workers then send
+     * each bucket to the worker sorting it (all-to-all).  Each worker
+     * sorts its bucket and writes it directly into the blocks it
+     * spans, on the workers that own them.</li>
+     * </ol>
+     * @param dsTag tag of the data structure to be sorted
+     * @param kernelId the id of the kernel that orders values
+     * @param count the number of values in the data structure
+     * @param perBlock the number of values in each block
+     */
+    void sort(unsigned int dsTag, int kernelId, unsigned long long count,
+              unsigned long long perBlock);
+
+    /**
+     * Perform a word-level operation on the bit-packed blocks of a
+     * data structure on the workers (see CacheWorker::bitwiseBlocks()).
+     * Blocks of both data structures in the manager's cache are
+     * written back to the workers first.  If the operation modifies
+     * the blocks, the cached copies are discarded as well.
+     * @param dsTag tag of the data structure to be counted or modified
+     * @param op the operation to be performed
+     * @param srcDs tag of the data structure holding the second operand
+     * @param blockCount the number of blocks in the data structure
+     * @param blockSize the size (in bytes, a multiple of 8) of each block
+     * @return the number of bits set for BIT_COUNT, otherwise zero
+     */
+    unsigned long long bitwise(unsigned int dsTag, BitOp op, unsigned int srcDs,
+                               size_t blockCount, size_t blockSize);
+
+    /**
+     * Record an access to a block of a data structure.  The
+     * CacheManager tracks the stride (in blocks) between successive
+     * accesses to different blocks of each data structure.  Once the
+     * same stride is seen twice in a row (e.g., a sequential or
+     * reverse scan), up to prefetchDepth blocks ahead along that
+     * stride are requested (see requestBlock()).
+     * @param dsTag tag of the data structure that was accessed
+     * @param blockTag tag of the block that was accessed
+     * @param blockCount the number of blocks in the data structure
+     * @param blockSize the size (in bytes) of the blocks in the data structure
+     */
+    void recordAccess(unsigned int dsTag, size_t blockTag, size_t blockCount,
+                      size_t blockSize);
+
+    /**
+     * The maximum number of blocks to prefetch ahead of the current
+     * block when an access pattern has been detected.  Zero disables
+     * prefetching.  The depth is further limited so that prefetched
+     * blocks do not fill the whole cache.
+     */
+    int prefetchDepth = 4;
+
+    /**
+     * The maximum number of blocks per worker that are being sent by
+     * streamBlock() at any time.
+     */
+    int storeDepth = 4;
+
     /**
      * Gives a reference to the manager's cache for use in insertion
      * logic
@@ -104,6 +455,181 @@ public:
     DataCache& managerCache() {
         return cache;
     }
+
+protected:
+    /**
+     * Send the changes to the blocks of a data structure in the
+     * manager's cache to the workers that own them (see
+     * writeDirtyRanges()), optionally discarding the cached copies.
+     * @param dsTag tag of the data structure whose blocks are to be sent
+     * @param drop if true, the blocks are removed from the cache
+     */
+    void writeBack(unsigned int dsTag, bool drop);
+
+    /**
+     * Encode a block being sent to its owner with the codec of its
+     * data structure (see setCodec()), if any.
+     * @param block the block to be sent
+     * @return the (possibly encoded) message to be sent
+     */
+    MessagePtr encodeBlock(const MessagePtr& block);
+
+    /**
+     * Send the changes to a block in the cache (see markDirty()) to
+     * the worker that owns it, if there are any, and mark the block
+     * as clean.  Blocks that were modified in a few small ranges are
+     * patched in place on the worker (see
+     * CacheWorker::patchCacheBlock()). Otherwise the whole block is
+     * sent.
+     * @param block the block to be written back
+     */
+    void writeDirtyRanges(const MessagePtr& block);
+
+    /**
+     * Record that bytes [first, last) of a block were modified,
+     * merging the range with the ranges recorded earlier.
+     * @param key the key of the block
+     * @param first offset of the first modified byte
+     * @param last offset one past the last modified byte
+     */
+    void addDirtyRange(size_t key, unsigned int first, unsigned int last);
+
+    /**
+     * Write back a block evicted from the cache, if it was modified.
+     * Clean blocks are identical to the owner's copy, so they are
+     * simply dropped.
+     * @param block the block that has been evicted
+     */
+    void evictBlock(const MessagePtr& block) override;
+
+    /**
+     * Remove a block from the cache, discarding its changes (if any).
+     * @param key the key of the block to be removed
+     */
+    void dropCacheBlock(size_t key) override;
+
+    /**
+     * Send a SAVE_DS or OPEN_DS request to all the workers and wait
+     * for their replies (see CacheWorker::replyStatus()).
+     * @param msg the request to be sent
+     * @throw Exception with the first error reported by a worker
+     */
+    void requestFileOperation(const MessagePtr& msg);
+
+    /**
+     * Create a GATHER or SCATTER message (see gatherValues()) for
+     * some of the values.
+     * @param dsTag tag of the data structure
+     * @param tag the tag of the message
+     * @param locations the (blockTag, byte offset) of all the values
+     * @param bucket the positions in \p locations of the values to
+     * be included, which are all owned by the same worker
+     * @param valueSize the size (in bytes) of each value
+     * @param values all the values (for SCATTER), or nullptr
+     * @return the message
+     */
+    MessagePtr makeGatherRequest(unsigned int dsTag, Message::MsgTag tag,
+                                 const std::vector<std::pair<size_t, size_t>>& locations,
+                                 const std::vector<size_t>& bucket, int valueSize,
+                                 const char* values);
+
+    /**
+     * Send one step of a distributed sort (see sort()) to all the
+     * workers.
+     * @param dsTag tag of the data structure being sorted
+     * @param info the information about the step
+     * @param data the data for the step
+     * @param dataSize the number of bytes in data
+     */
+    void sendSortStep(unsigned int dsTag, const SortInfo& info,
+                      const char* data, int dataSize);
+
+    /**
+     * Wait until a requested block (see requestBlock()) has arrived,
+     * adding any other requested blocks that arrive in the meantime
+     * to the cache.
+     * @param key the key of the block to wait for
+     */
+    void waitForBlock(size_t key);
+
+    /**
+     * Wait until all requested blocks (see requestBlock()) have
+     * arrived, adding them to the cache.  This is called before
+     * operations that drop, replace, or process blocks on the
+     * workers, since blocks requested earlier must not be cached
+     * once they arrive.
+     */
+    void waitForPendingBlocks();
+
+    /**
+     * Add requested blocks that have already arrived to the cache,
+     * without waiting for any other blocks.
+     */
+    void receiveArrivedBlocks();
+
+    /**
+     * Process the reply to a block request.  The block is added to
+     * the cache, unless a copy of the block is already in the cache
+     * (which must be newer than the one that was requested).
+     * @param msg the reply from the worker
+     */
+    void receiveBlock(const MessagePtr& msg);
+
+    /**
+     * The blocks that have been requested from workers but have not
+     * arrived yet. The key is the block's key and the value is the
+     * rank the block was requested from.
+     */
+    std::unordered_map<size_t, int> pending;
+
+    /**
+     * The information tracked about accesses to a data structure to
+     * detect access patterns.
+     */
+    struct AccessPattern {
+        /** The block that was accessed last (-1 if none) */
+        long long lastBlock = -1;
+        /** The stride between the last two blocks accessed */
+        long long stride = 0;
+        /** Number of times the stride was repeated consecutively */
+        int repeats = 0;
+    };
+
+    /**
+     * The access pattern tracked for each data structure
+     */
+    std::unordered_map<unsigned int, AccessPattern> patterns;
+
+    /**
+     * The codec (see setCodec()) and value size used for each data
+     * structure whose blocks are encoded.
+     */
+    std::unordered_map<unsigned int, std::pair<int, int>> codecs;
+
+    /**
+     * The write policy of each data structure that does not use
+     * WRITE_BACK (see setWritePolicy()).
+     */
+    std::unordered_map<unsigned int, WritePolicy> writePolicies;
+
+    /**
+     * The modified byte ranges [first, second) of each block in the
+     * cache that was modified (see markDirty()), sorted and without
+     * overlaps.  Clean blocks have no entry.
+     */
+    std::unordered_map<size_t, std::vector<std::pair<unsigned int, unsigned int>>> dirty;
+
+    /**
+     * The number of ranges tracked per block, beyond which the
+     * ranges are merged into one range spanning all of them.
+     */
+    static constexpr size_t MaxDirtyRanges = 16;
+
+    /**
+     * The keys of the cached blocks that may be modified in place by
+     * whoever holds them (see markWritable()).
+     */
+    std::unordered_set<size_t> writable;
 };
 
 
@@ -47,9 +47,12 @@
  * 
  */
 
+#include <memory>
+#include <string>
 #include <unordered_map>
-#include <list>
+#include <vector>
 #include "Worker.h"
+#include "EvictionPolicy.h"
 
 
 // namespace pc2l {
@@ -76,16 +79,31 @@ using DataCache = std::unordered_map<size_t, MessagePtr>;
  */
 class CacheWorker : public Worker {
 public:
+    /**
+     * The schemes to choose the blocks to be evicted when the cache
+     * is full (see setEvictionStrategy() and EvictionPolicy).
+     */
     enum EvictionStrategy : int {
-        LRU = 1,
-        MRU,
-        LFU
+        LRU = 1, /**< Least recently used (see RecencyPolicy) */
+        MRU,     /**< Most recently used (see RecencyPolicy) */
+        LFU,     /**< Least frequently used (see LfuPolicy) */
+        CLOCK,   /**< Approximate LRU with reference bits (see ClockPolicy) */
+        ARC      /**< Adaptive replacement cache (see ArcPolicy) */
     };
 
-    // Maximum cache size in bytes of this cacheworker
+    /**
+     * The operations on bit-packed blocks (see bitwiseBlocks()).
+     */
+    enum BitOp : int {
+        BIT_COUNT = 1, /**< Count the bits that are set */
+        BIT_AND,       /**< dest &= src, block by block */
+        BIT_OR,        /**< dest |= src, block by block */
+        BIT_XOR        /**< dest ^= src, block by block */
+    };
+
+    // Maximum cache size in bytes of this cacheworker, including the
+    // header (see Message::getSize()) of each block
     unsigned long long cacheSize = 16000000000;
-    // Eviction strategy used to remove from the cache when cache size exceeded
-    EvictionStrategy evictionStrategy = EvictionStrategy::LRU;
     /**
      * The default constructor.  Currently, the consructor initializes
      * some of the instance variables in this class.
@@ -131,14 +149,28 @@ public:
      */
     static size_t getKey(size_t dsTag, size_t blockTag) noexcept {
         size_t key = dsTag;
-        key <<= sizeof(dsTag);
+        key <<= 32;
         key  |= blockTag;
         return key;
     }
 
+    /**
+     * Convenience helper method to determine the rank of the worker
+     * process that is the home for a given block.  Blocks are spread
+     * across the worker processes (i.e., processes with MPI-rank > 0)
+     * in a round-robin manner based on their block tag.
+     *
+     * \param[in] blockTag tag associated with selected block
+     *
+     * \return The rank of the worker process that stores the block.
+     */
+    static int getOwnerRank(size_t blockTag);
+
     /**
      * Method that computes hash and stores a block of cache data from
-     * a given message.
+     * a given message.  If the message owns its buffer, it is stored
+     * directly (without cloning).  Consequently, subsequent changes
+     * to such a message are reflected in the cache.
      *
      * \param[in] msg The message that contains a block of cache data
      * to be stored.
@@ -163,29 +195,539 @@ public:
     void sendCacheBlock(const MessagePtr& msg);
 
     /**
-     * Refer the key for a block to our eviction scheme
+     * Method that shifts the contents of a block of cache data in
+     * place and sends the bytes shifted out of the block back to the
+     * process that requested the shift.  If the block is not found,
+     * the reply has an empty payload.  The payload of the message
+     * consists of two integers, namely the byte offset in the block
+     * where shifting starts and the direction (non-zero for right),
+     * followed by the bytes to be carried into the block.
+     *
+     * \param[in] msg The message with the shift request.
+     */
+    void shiftCacheBlock(const MessagePtr& msg);
+
+    /**
+     * Method that overwrites byte ranges of a block of cache data in
+     * place, without a reply.  The payload of the message is a
+     * sequence of records, each consisting of two unsigned integers,
+     * namely the byte offset in the block and the number of bytes,
+     * followed by the bytes.  Patches to a block that is not found
+     * (i.e., it has been dropped) are ignored.
+     *
+     * \param[in] msg The message with the patch.
+     */
+    void patchCacheBlock(const MessagePtr& msg);
+
+    /**
+     * Method that copies values out of several blocks of a data
+     * structure and sends just the values back to the requestor.  The
+     * payload of the message is a GatherInfo followed by one
+     * (blockTag, byte offset) pair (unsigned long longs) per value.
+     * The payload of the reply is the values, in the same order.
+     * Values in blocks that are not found are zeros.
+     *
+     * \param[in] msg The message with the gather request.
+     */
+    void gatherValues(const MessagePtr& msg);
+
+    /**
+     * Method that writes values into several blocks of a data
+     * structure in place, without a reply.  The payload of the
+     * message is the same as for gatherValues(), followed by the
+     * values.  Values for blocks that are not found are ignored.
+     *
+     * \param[in] msg The message with the scatter request.
+     */
+    void scatterValues(const MessagePtr& msg);
+
+    /**
+     * Shift bytes [offset, blockSize) of a block left or right by
+     * carryLen bytes.  Conceptually, on a right shift the carry is
+     * prepended to bytes [offset, blockSize) and on a left shift it
+     * is appended to them.  The first (blockSize - offset) bytes of
+     * the resulting sequence are stored back at \p offset (right
+     * shift) or the last (blockSize - offset) bytes are (left
+     * shift) and the remaining carryLen bytes are the carry-out.
+     * Chaining the carry-out from one block into the next moves
+     * a range of data across blocks, one block at a time.
+     *
+     * \param[in,out] block The payload of the block to be shifted.
+     *
+     * \param[in] blockSize The size of the block in bytes.
+     *
+     * \param[in] offset Byte offset in the block where shifting starts.
+     *
+     * \param[in] right If true shift right, otherwise shift left.
+     *
+     * \param[in] carryIn The carryLen bytes to be carried into the block.
+     *
+     * \param[in] carryLen The number of bytes to shift by.
+     *
+     * \param[out] carryOut Buffer to hold the carryLen bytes that are
+     * shifted out of the block.
+     */
+    static void shiftBlock(char* block, int blockSize, int offset, bool right,
+                           const char* carryIn, int carryLen, char* carryOut);
+
+    /**
+     * Method that records that a range of blocks of a data structure
+     * is uniformly filled with a given value.  Cached copies of these
+     * blocks are discarded.  The blocks are not created right away.
+     * Instead, each block is materialized (see materializeBlock())
+     * when it is first requested.  Earlier fills within the range are
+     * discarded.  The payload of the message is a FillInfo followed
+     * by the bytes of the value.  The blockTag of the message is the
+     * first block in the range.
+     *
+     * \param[in] msg The message with the fill request.
+     */
+    void fillCacheBlocks(const MessagePtr& msg);
+
+    /**
+     * Method that frees all the blocks (and fills, see
+     * fillCacheBlocks()) of the data structure whose dsTag is
+     * specified in the message.
+     *
+     * \param[in] msg The message with the dsTag of the data structure
+     * to be dropped.
+     */
+    void dropDataStructure(const MessagePtr& msg);
+
+    /**
+     * Method that copies all the blocks (and fills, see
+     * fillCacheBlocks()) of the data structure whose dsTag is
+     * specified in the message into a new data structure.  Each
+     * worker copies the blocks it holds, so no blocks are sent over
+     * the network.  The payload of the message is the dsTag (an
+     * unsigned int) of the new data structure.
+     *
+     * \param[in] msg The message with the dsTag of the data structure
+     * to be copied.
+     */
+    void cloneDataStructure(const MessagePtr& msg);
+
+    /**
+     * Method that runs a registered kernel (see Kernel) on all the
+     * blocks of a data structure that are owned by this worker and
+     * sends the partial result back to the requestor.  The payload
+     * of the message is a ComputeInfo.  The payload of the reply is
+     * a flag (one byte, non-zero if there is a result) followed by
+     * the partial result.
+     *
+     * \param[in] msg The message with the compute request.
+     */
+    void computeBlocks(const MessagePtr& msg);
+
+    /**
+     * Method that performs the worker's part of each step of a
+     * distributed sample sort of a data structure.  The payload of
+     * the message is a SortInfo followed by data that depends on the
+     * step (see SortInfo::Step).  The steps are coordinated by the
+     * CacheManager (see CacheManager::sort()), except for the DATA and
+     * WRITE steps, which are exchanged directly between workers.
+     *
+     * \param[in] msg The message with the sort request.
+     */
+    void sortBlocks(const MessagePtr& msg);
+
+    /**
+     * Method that performs a word-level operation (see BitOp) on all
+     * the bit-packed blocks of a data structure that are owned by
+     * this worker.  For BIT_AND, BIT_OR, and BIT_XOR, each block of
+     * the data structure is combined with the block with the same
+     * blockTag of the source data structure, which is owned by this
+     * worker as well (see getOwnerRank()).  Missing source blocks
+     * are all zeros.  The payload of the message is a BitwiseInfo.
+     * The payload of the reply is the number of bits that are set
+     * (for BIT_COUNT) or zero.
+     *
+     * \param[in] msg The message with the bitwise request.
+     */
+    void bitwiseBlocks(const MessagePtr& msg);
+
+    /**
+     * Method that finds or counts the values in the blocks of a data
+     * structure owned by this worker that satisfy a predicate: either
+     * a registered kernel (see Kernel::test()) or equality with a
+     * given value.  The payload of the message is a SearchInfo,
+     * followed by the bytes of the value when no kernel is used.
+     * When finding, blocks are scanned in order and the scan stops
+     * at the first match.  The payload of the reply is the index of
+     * the first match (or the number of values if there is none), or
+     * the number of matches.
+     *
+     * \param[in] msg The message with the search request.
+     */
+    void searchBlocks(const MessagePtr& msg);
+
+    /**
+     * Method that writes the blocks of a data structure owned by this
+     * worker to its file in a directory (see getBlockFile()).  The
+     * file starts with the number of blocks, followed by an index of
+     * (blockTag, offset, size) entries, followed by the blocks.  The
+     * payload of the message is the number of blocks in the data
+     * structure (an unsigned long long) followed by the directory.
+     * The payload of the reply is empty on success or an error message.
+     *
+     * \param[in] msg The message with the save request.
+     */
+    void saveDataStructure(const MessagePtr& msg);
+
+    /**
+     * Method that maps the file of this worker in a directory (see
+     * saveDataStructure()) into memory as the blocks of a new data
+     * structure.  Blocks are copied out of the mapping (faulting its
+     * pages in) only when they are first needed (see
+     * materializeBlock()).  The payload of the message is the
+     * directory.  The payload of the reply is empty on success or an
+     * error message.
+     *
+     * \param[in] msg The message with the open request.
+     */
+    void openDataStructure(const MessagePtr& msg);
+
+    /**
+     * Returns the path of the file holding the blocks of a worker in
+     * a directory (see saveDataStructure()).
+     *
+     * \param[in] dir The directory.
+     *
+     * \param[in] rank The rank of the worker.
+     *
+     * \return The path of the file.
+     */
+    static std::string getBlockFile(const std::string& dir, int rank);
+
+    /**
+     * Refer the key for a block to our eviction scheme, evicting
+     * blocks until the block fits within cacheSize bytes
      * @param key the key to place into eviction scheme
      */
      void refer(const MessagePtr& msg);
+
+    /**
+     * Change the scheme used to choose the blocks to be evicted from
+     * the cache.  The blocks in the cache are kept, but their access
+     * history is lost.
+     *
+     * \param[in] strategy The eviction scheme to be used.
+     */
+    void setEvictionStrategy(EvictionStrategy strategy);
+
+    /**
+     * Obtain the scheme used to choose the blocks to be evicted from
+     * the cache (see setEvictionStrategy()).
+     *
+     * \return The eviction scheme.
+     */
+    EvictionStrategy getEvictionStrategy() const { return evictionStrategy; }
+
+    /**
+     * Obtain the number of bytes held by the cache, including the
+     * header (see Message::getSize()) of each block.
+     *
+     * \return The number of bytes in the cache.
+     */
+    unsigned long long getCachedBytes() const { return cachedBytes; }
 protected:
+    /**
+     * Handle a block that has been evicted from the cache (see
+     * refer()).  Workers send the block to its owner, while the
+     * CacheManager sends just the changes, if any (see
+     * CacheManager::markDirty()).
+     *
+     * \param[in] block The block that has been evicted.
+     */
+    virtual void evictBlock(const MessagePtr& block);
+
+    /**
+     * The information at the start of the payload of a FILL_BLOCK
+     * message (see fillCacheBlocks()).
+     */
+    struct FillInfo {
+        /** One past the last block in the range to be filled */
+        unsigned long long lastBlock;
+        /** The size (in bytes) of each block */
+        unsigned long long blockSize;
+    };
+
+    /**
+     * The payload of a COMPUTE message (see computeBlocks()).
+     */
+    struct ComputeInfo {
+        /** The id of the kernel to be run */
+        int kernel;
+        /** The number of values in the data structure */
+        unsigned long long count;
+        /** The number of values in each block */
+        unsigned long long perBlock;
+    };
+
+    /**
+     * The information at the start of the payload of a SORT message
+     * (see sortBlocks()).
+     */
+    struct SortInfo {
+        /** The steps of a distributed sample sort */
+        enum Step : int {
+            /** Sort local values and reply with evenly spaced samples */
+            SAMPLE,
+            /** Reply with the number of local values in each bucket,
+                given the splitters that follow this SortInfo */
+            PARTITION,
+            /** Send each bucket to its worker, given the position in
+                the sorted data structure where each bucket starts */
+            EXCHANGE,
+            /** The values of a bucket sent by another worker */
+            DATA,
+            /** Sorted values to be written into owned blocks, as
+                records of (blockTag, first value, count, values) */
+            WRITE
+        };
+        /** The step to be performed */
+        int step;
+        /** The id of the kernel that orders values */
+        int kernel;
+        /** The number of values in the data structure */
+        unsigned long long count;
+        /** The number of values in each block */
+        unsigned long long perBlock;
+    };
+
+    /**
+     * The information at the start of the payload of a SEARCH message
+     * (see searchBlocks()).
+     */
+    struct SearchInfo {
+        /** The id of the predicate kernel, or -1 to compare values */
+        int kernel;
+        /** If non-zero, find the first match.  Otherwise, count them */
+        int findFirst;
+        /** The number of values in the data structure */
+        unsigned long long count;
+        /** The number of values in each block */
+        unsigned long long perBlock;
+        /** The size (in bytes) of each value */
+        unsigned long long valueSize;
+    };
+
+    /**
+     * The information at the start of the payload of GATHER and
+     * SCATTER messages (see gatherValues()).
+     */
+    struct GatherInfo {
+        /** The number of values */
+        unsigned long long count;
+        /** The size (in bytes) of each value */
+        unsigned long long valueSize;
+    };
+
+    /**
+     * Helper method to find a block in the cache, materializing it if
+     * it was filled lazily or is in a mapped file.  Encoded blocks
+     * (see BlockCodec) are decoded in place if requested, so that the
+     * block can be modified in place.
+     *
+     * \param[in] dsTag The tag of the data structure the block belongs to.
+     *
+     * \param[in] blockTag The tag of the block.
+     *
+     * \param[in] decode If true, an encoded block is replaced by its
+     * decoded version in the cache.
+     *
+     * \return An iterator to the block in the cache, or cache.end()
+     * if the block is not found.
+     */
+    DataCache::iterator findCacheBlock(unsigned int dsTag, size_t blockTag,
+                                       bool decode = true);
+
+    /**
+     * Helper method to obtain a block in the cache that is only read.
+     * Unlike findCacheBlock(), an encoded block stays encoded in the
+     * cache and a decoded copy of it is returned instead.
+     *
+     * \param[in] dsTag The tag of the data structure the block belongs to.
+     *
+     * \param[in] blockTag The tag of the block.
+     *
+     * \return The (decoded) block, or nullptr if the block is not
+     * found.  The block must not be modified.
+     */
+    MessagePtr readCacheBlock(unsigned int dsTag, size_t blockTag);
+
+    /**
+     * The payload of a BITWISE message (see bitwiseBlocks()).
+     */
+    struct BitwiseInfo {
+        /** The operation to be performed (see BitOp) */
+        int op;
+        /** The tag of the data structure holding the second operand */
+        unsigned int srcDs;
+        /** The number of blocks in the data structure */
+        unsigned long long blockCount;
+        /** The size (in bytes, a multiple of 8) of each block */
+        unsigned long long blockSize;
+    };
+
+    /**
+     * The blocks of a data structure in a memory-mapped file (see
+     * openDataStructure()).
+     */
+    struct MappedFile {
+        /** The mapping of the file, which is unmapped when released */
+        std::shared_ptr<char> base;
+        /** The position and size of each block in the file, by blockTag */
+        std::unordered_map<size_t, std::pair<size_t, size_t>> blocks;
+    };
+
+    /**
+     * The state of a worker during a distributed sample sort of a
+     * data structure (see sortBlocks()).
+     */
+    struct SortState {
+        /** The SortInfo from the SAMPLE step */
+        SortInfo info;
+        /** The rank of the process that coordinates the sort */
+        int manager = 0;
+        /** The sorted values from the blocks owned by this worker */
+        std::vector<char> values;
+        /** The index in values where each bucket ends */
+        std::vector<unsigned long long> bounds;
+        /** The bucket this worker sorts, as received so far */
+        std::vector<char> bucket;
+        /** The first position of each bucket in the sorted data
+            structure, followed by the number of values */
+        std::vector<unsigned long long> starts;
+        /** Number of parts of the bucket received (DATA steps) */
+        int parts = 0;
+        /** Number of WRITE steps received and expected */
+        int writes = 0, expectedWrites = 0;
+        /** Flags to indicate progress through the steps */
+        bool exchanged = false, written = false;
+    };
+
+    /**
+     * Helper method to advance a distributed sort once all the
+     * messages a step depends on have been received: the bucket is
+     * sorted and written once all its parts have been received, and
+     * the manager is notified once all writes to owned blocks are
+     * done.
+     *
+     * \param[in] dsTag The tag of the data structure being sorted.
+     */
+    void progressSort(unsigned int dsTag);
+
+    /**
+     * Helper method to obtain a block in the cache that is safe to
+     * modify in place, creating it if needed (see materializeBlock()).
+     *
+     * \param[in] dsTag The tag of the data structure the block belongs to.
+     *
+     * \param[in] blockTag The tag of the block.
+     *
+     * \param[in] blockSize The size of the block, if it must be created.
+     *
+     * \return The block.
+     */
+    MessagePtr& ownedBlock(unsigned int dsTag, size_t blockTag, int blockSize);
+
+    /**
+     * Create a block that is part of a range of blocks that was
+     * filled earlier (see fillCacheBlocks()), or that is in a mapped
+     * file (see openDataStructure()), and add it to the cache.
+     *
+     * \param[in] dsTag The tag of the data structure the block belongs to.
+     *
+     * \param[in] blockTag The tag of the block to be created.
+     *
+     * \return The newly created block, or nullptr if the block is not
+     * part of a filled range of blocks or of a mapped file (see
+     * openDataStructure()).
+     */
+    MessagePtr materializeBlock(unsigned int dsTag, size_t blockTag);
+
+    /**
+     * Helper method to send the reply to a SAVE_DS or OPEN_DS request.
+     *
+     * \param[in] msg The request.
+     *
+     * \param[in] error The error message, or an empty string on success.
+     */
+    void replyStatus(const MessagePtr& msg, const std::string& error);
+
+    /**
+     * Helper method to remove a block from the cache along with its
+     * entry in the eviction structures, if any.
+     *
+     * \param[in] key The key of the block to be removed.
+     */
+    virtual void dropCacheBlock(size_t key);
+
+    /**
+     * Helper method to discard cached blocks of a data structure in
+     * the range [firstBlock, lastBlock).
+     *
+     * \param[in] dsTag The tag of the data structure.
+     *
+     * \param[in] firstBlock The first block in the range.
+     *
+     * \param[in] lastBlock One past the last block in the range.
+     */
+    void dropCacheBlocks(unsigned int dsTag, size_t firstBlock,
+                         size_t lastBlock);
+
+    /**
+     * Helper method to obtain a block in the cache that is safe to
+     * modify in place.  If the block is still referenced elsewhere
+     * (for example, because it is being sent via a non-blocking
+     * send) the cache entry is replaced with a copy of the block.
+     *
+     * \param[in,out] block The cache entry of the block to be modified.
+     *
+     * \return The (possibly updated) cache entry.
+     */
+    MessagePtr& writableBlock(MessagePtr& block);
+
     /**
      * The in-memory data cache managed by this worker process.
      */
     DataCache cache;
 
-    // Queue: front is block to remove
-    std::list<size_t> lruBlock;
+    /**
+     * The number of bytes held by the cache (see getCachedBytes()).
+     */
+    unsigned long long cachedBytes = 0;
+
+    /**
+     * The eviction scheme in use (see setEvictionStrategy()).
+     */
+    EvictionStrategy evictionStrategy = LRU;
+
+    /**
+     * The policy tracking the blocks in the cache to choose the
+     * blocks to be evicted (see refer()).
+     */
+    std::unique_ptr<EvictionPolicy> eviction;
+
+    /**
+     * The FILL_BLOCK messages (see fillCacheBlocks()) received for
+     * each data structure, in the order they were received.  Fills
+     * whose range is covered by a later fill are discarded.
+     */
+    std::unordered_map<unsigned int, std::vector<MessagePtr>> fills;
+
+    /**
+     * The state of the distributed sorts in progress, if any, by
+     * the tag of the data structure being sorted.
+     */
+    std::unordered_map<unsigned int, SortState> sorts;
 
-    // Stores a key and a reference to that key's place in the LRU/MRU/etc queue
-    std::unordered_map<size_t, std::list<size_t>::iterator> placeInQ;
-private:
     /**
-     * This is a convenience message that is created in the
-     * constructor.  This is used to quickly send a "block-not-found"
-     * response in case a block was requested and it was not found.
-     * This message is reused to minimize message creation overheads.
+     * The memory-mapped files holding blocks of data structures (see
+     * openDataStructure()), by the tag of the data structure.
      */
-    MessagePtr blockNotFoundMsg;
+    std::unordered_map<unsigned int, MappedFile> mapped;
 };
 
 END_NAMESPACE(pc2l);
@@ -0,0 +1,249 @@
+#ifndef EVICTION_POLICY_H
+#define EVICTION_POLICY_H
+
+//---------------------------------------------------------------------
+//  ____ 
+// |  _ \    This file is part of  PC2L:  A Parallel & Cloud Computing 
+// | |_) |   Library <http://www.pc2lab.cec.miamioh.edu/pc2l>. PC2L is 
+// |  __/    free software: you can  redistribute it and/or  modify it
+// |_|       under the terms of the GNU  General Public License  (GPL)
+//           as published  by  the   Free  Software Foundation, either
+//           version 3 (GPL v3), or  (at your option) a later version.
+//    
+//   ____    PC2L  is distributed in the hope that it will  be useful,
+//  / ___|   but   WITHOUT  ANY  WARRANTY;  without  even  the IMPLIED
+// | |       WARRANTY of  MERCHANTABILITY  or FITNESS FOR A PARTICULAR
+// | |___    PURPOSE.
+//  \____| 
+//            Miami University and  the PC2Lab development team make no
+//            representations  or  warranties  about the suitability of
+//  ____      the software,  either  express  or implied, including but
+// |___ \     not limited to the implied warranties of merchantability,
+//   __) |    fitness  for a  particular  purpose, or non-infringement.
+//  / __/     Miami  University and  its affiliates shall not be liable
+// |_____|    for any damages  suffered by the  licensee as a result of
+//            using, modifying,  or distributing  this software  or its
+//            derivatives.
+//
+//  _         By using or  copying  this  Software,  Licensee  agree to
+// | |        abide  by the intellectual  property laws,  and all other
+// | |        applicable  laws of  the U.S.,  and the terms of the  GNU
+// | |___     General  Public  License  (version 3).  You  should  have
+// |_____|    received a  copy of the  GNU General Public License along
+//            with MUSE.  If not,  you may  download  copies  of GPL V3
+//            from <http://www.gnu.org/licenses/>.
+//
+// --------------------------------------------------------------------
+// Authors:   Dhananjai M. Rao          raodm@miamioh.edu
+//---------------------------------------------------------------------
+/**
+ * @file EvictionPolicy.h
+ * @brief Definition of EvictionPolicy, the interface of the schemes
+ * used to choose the blocks to be evicted from a cache, and of the
+ * built-in schemes.
+ * @version 0.1
+ * @date 2022-05-20
+ */
+
+#include <functional>
+#include <list>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include "Utilities.h"
+
+BEGIN_NAMESPACE(pc2l);
+
+/**
+ * The interface of an eviction scheme for the cache of a CacheWorker
+ * (or of the CacheManager).  The policy tracks the keys of the
+ * blocks in the cache: it is told when blocks are added, accessed,
+ * or removed, and chooses the block to be evicted when the cache is
+ * full (see CacheWorker::refer()).  Blocks that are pinned (still
+ * referenced outside of the cache) must not be chosen.
+ */
+class EvictionPolicy {
+public:
+    /**
+     * The polymorphic destructor.
+     */
+    virtual ~EvictionPolicy() {}
+
+    /**
+     * Record that a block has been added to the cache.
+     *
+     * \param[in] key The key of the block.
+     */
+    virtual void insert(size_t key) = 0;
+
+    /**
+     * Record that a block in the cache has been accessed.
+     *
+     * \param[in] key The key of the block.
+     */
+    virtual void access(size_t key) = 0;
+
+    /**
+     * Record that a block has been removed from the cache, other than
+     * by evict().
+     *
+     * \param[in] key The key of the block.
+     */
+    virtual void erase(size_t key) = 0;
+
+    /**
+     * Choose a block to be evicted to make room for another block,
+     * and stop tracking it.
+     *
+     * \param[in] incoming The key of the block that is about to be
+     * added to the cache (see insert()).
+     *
+     * \param[in] evictable Callback that returns false for the keys
+     * of blocks that are pinned and cannot be evicted.
+     *
+     * \param[out] victim The key of the block to be evicted.
+     *
+     * \return false if no block can be evicted.
+     */
+    virtual bool evict(size_t incoming, const std::function<bool(size_t)>& evictable,
+                       size_t& victim) = 0;
+};
+
+/**
+ * Evicts the least recently used (LRU) or the most recently used
+ * (MRU) block.  MRU suits cyclic scans over more blocks than the
+ * cache holds, for which LRU evicts each block just before it is
+ * needed again.
+ */
+class RecencyPolicy : public EvictionPolicy {
+public:
+    /**
+     * Create the policy.
+     *
+     * \param[in] mostRecent If true, evict the most recently used
+     * block.  Otherwise evict the least recently used one.
+     */
+    explicit RecencyPolicy(bool mostRecent) : mostRecent(mostRecent) {}
+
+    void insert(size_t key) override;
+    void access(size_t key) override;
+    void erase(size_t key) override;
+    bool evict(size_t incoming, const std::function<bool(size_t)>& evictable,
+               size_t& victim) override;
+
+private:
+    /** If true, evict the most recently used block */
+    const bool mostRecent;
+    /** The keys, from the most to the least recently used */
+    std::list<size_t> order;
+    /** The position of each key in order */
+    std::unordered_map<size_t, std::list<size_t>::iterator> places;
+};
+
+/**
+ * Evicts the least frequently used (LFU) block, breaking ties in
+ * favor of evicting the least recently used one.
+ */
+class LfuPolicy : public EvictionPolicy {
+public:
+    void insert(size_t key) override;
+    void access(size_t key) override;
+    void erase(size_t key) override;
+    bool evict(size_t incoming, const std::function<bool(size_t)>& evictable,
+               size_t& victim) override;
+
+private:
+    /** The (access count, time of last access, key) of each block */
+    using Usage = std::tuple<unsigned long long, unsigned long long, size_t>;
+    /** The usage of the blocks, from the block to be evicted first */
+    std::set<Usage> order;
+    /** The usage of each key in order */
+    std::unordered_map<size_t, Usage> usages;
+    /** The number of inserts and accesses so far */
+    unsigned long long time = 0;
+};
+
+/**
+ * The CLOCK approximation of LRU.  The keys are held in a circular
+ * buffer along with a reference bit, so that an access just sets the
+ * bit of the block.  A hand sweeps the buffer, clearing the bits that
+ * are set, and evicts the first block whose bit is clear.
+ */
+class ClockPolicy : public EvictionPolicy {
+public:
+    void insert(size_t key) override;
+    void access(size_t key) override;
+    void erase(size_t key) override;
+    bool evict(size_t incoming, const std::function<bool(size_t)>& evictable,
+               size_t& victim) override;
+
+private:
+    /** An entry in the circular buffer */
+    struct Slot {
+        /** The key of the block in this slot */
+        size_t key;
+        /** True if the block was accessed since the hand last passed */
+        bool referenced;
+        /** False if the slot is free */
+        bool used;
+    };
+    /** The circular buffer */
+    std::vector<Slot> slots;
+    /** The slots that are free, to be reused by insert() */
+    std::vector<size_t> freeSlots;
+    /** The slot of each key */
+    std::unordered_map<size_t, size_t> slotOf;
+    /** The slot the hand points to */
+    size_t hand = 0;
+};
+
+/**
+ * Adaptive Replacement Cache (ARC).  Blocks seen once (T1) and blocks
+ * seen at least twice (T2) are kept in separate LRU lists, along
+ * with the keys of blocks recently evicted from either list (the
+ * ghost lists B1 and B2).  A hit in a ghost list shows that the
+ * corresponding list is too short, so the target size of T1 adapts
+ * to the workload: scans and loops do not flush frequently used
+ * blocks.  The capacity (in blocks) used to bound the ghost lists is
+ * the largest number of blocks the cache has held.
+ */
+class ArcPolicy : public EvictionPolicy {
+public:
+    void insert(size_t key) override;
+    void access(size_t key) override;
+    void erase(size_t key) override;
+    bool evict(size_t incoming, const std::function<bool(size_t)>& evictable,
+               size_t& victim) override;
+
+private:
+    /** The lists, each ordered from the most recently used key */
+    enum ListId { T1, T2, B1, B2, LIST_COUNT };
+
+    /**
+     * Move a key to the front of a list.
+     *
+     * \param[in] key The key to be moved.
+     *
+     * \param[in] to The list the key is moved to.
+     */
+    void moveTo(size_t key, ListId to);
+
+    /**
+     * Drop the least recently used ghost keys beyond the capacity.
+     */
+    void trimGhosts();
+
+    /** The lists of keys */
+    std::list<size_t> lists[LIST_COUNT];
+    /** The list holding each key and its position in it */
+    std::unordered_map<size_t, std::pair<ListId, std::list<size_t>::iterator>> places;
+    /** The target size of T1 */
+    size_t target = 0;
+    /** The largest number of blocks in T1 and T2 so far */
+    size_t capacity = 0;
+};
+
+END_NAMESPACE(pc2l);
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef FUTURE_H
+#define FUTURE_H
+
+//---------------------------------------------------------------------
+//  ____ 
+// |  _ \    This file is part of  PC2L:  A Parallel & Cloud Computing 
+// | |_) |   Library <http://www.pc2lab.cec.miamioh.edu/pc2l>. PC2L is 
+// |  __/    free software: you can  redistribute it and/or  modify it
+// |_|       under the terms of the GNU  General Public License  (GPL)
+//           as published  by  the   Free  Software Foundation, either
+//           version 3 (GPL v3), or  (at your option) a later version.
+//    
+//   ____    PC2L  is distributed in the hope that it will  be useful,
+//  / ___|   but   WITHOUT  ANY  WARRANTY;  without  even  the IMPLIED
+// | |       WARRANTY of  MERCHANTABILITY  or FITNESS FOR A PARTICULAR
+// | |___    PURPOSE.
+//  \____| 
+//            Miami University and  the PC2Lab development team make no
+//            representations  or  warranties  about the suitability of
+//  ____      the software,  either  express  or implied, including but
+// |___ \     not limited to the implied warranties of merchantability,
+//   __) |    fitness  for a  particular  purpose, or non-infringement.
+//  / __/     Miami  University and  its affiliates shall not be liable
+// |_____|    for any damages  suffered by the  licensee as a result of
+//            using, modifying,  or distributing  this software  or its
+//            derivatives.
+//
+//  _         By using or  copying  this  Software,  Licensee  agree to
+// | |        abide  by the intellectual  property laws,  and all other
+// | |        applicable  laws of  the U.S.,  and the terms of the  GNU
+// | |___     General  Public  License  (version 3).  You  should  have
+// |_____|    received a  copy of the  GNU General Public License along
+//            with MUSE.  If not,  you may  download  copies  of GPL V3
+//            from <http://www.gnu.org/licenses/>.
+//
+// --------------------------------------------------------------------
+// Authors:   Dhananjai M. Rao          raodm@miamioh.edu
+//---------------------------------------------------------------------
+/**
+ * @file Future.h
+ * @brief Definition of Future, a handle to the result of an
+ * asynchronous operation on a data structure.
+ * @version 0.1
+ * @date 2022-05-16
+ */
+
+#include <functional>
+#include <utility>
+#include "Utilities.h"
+
+BEGIN_NAMESPACE(pc2l);
+
+/**
+ * A handle to the result of an asynchronous operation, such as
+ * Vector::atAsync().  The operation is started when the handle is
+ * created, so that many operations can be in flight at the same time.
+ * Unlike std::future, no threads are involved: progress is made (and
+ * messages that have arrived are processed) when ready() or get() is
+ * called on any handle, or when the CacheManager is used otherwise.
+ *
+ * @tparam R the type of the result, which may be void
+ */
+template <typename R>
+class Future {
+public:
+    /**
+     * Create a handle for an operation that has been started.
+     * @param isReady checks, without waiting, if the result is available
+     * @param result waits for and returns the result
+     */
+    Future(std::function<bool()> isReady, std::function<R()> result) :
+        isReady(std::move(isReady)), result(std::move(result)) {}
+
+    /**
+     * Determine, without waiting, if get() would return immediately.
+     * @return true if the result is available
+     */
+    bool ready() const {
+        return isReady();
+    }
+
+    /**
+     * Wait for the operation to complete and obtain its result.
+     * @return the result of the operation
+     */
+    R get() const {
+        return result();
+    }
+
+private:
+    /** Checks if the result is available */
+    std::function<bool()> isReady;
+    /** Waits for and returns the result */
+    std::function<R()> result;
+};
+
+END_NAMESPACE(pc2l);
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef KERNEL_H
+#define KERNEL_H
+
+//---------------------------------------------------------------------
+//  ____ 
+// |  _ \    This file is part of  PC2L:  A Parallel & Cloud Computing 
+// | |_) |   Library <http://www.pc2lab.cec.miamioh.edu/pc2l>. PC2L is 
+// |  __/    free software: you can  redistribute it and/or  modify it
+// |_|       under the terms of the GNU  General Public License  (GPL)
+//           as published  by  the   Free  Software Foundation, either
+//           version 3 (GPL v3), or  (at your option) a later version.
+//    
+//   ____    PC2L  is distributed in the hope that it will  be useful,
+//  / ___|   but   WITHOUT  ANY  WARRANTY;  without  even  the IMPLIED
+// | |       WARRANTY of  MERCHANTABILITY  or FITNESS FOR A PARTICULAR
+// | |___    PURPOSE.
+//  \____| 
+//            Miami University and  the PC2Lab development team make no
+//            representations  or  warranties  about the suitability of
+//  ____      the software,  either  express  or implied, including but
+// |___ \     not limited to the implied warranties of merchantability,
+//   __) |    fitness  for a  particular  purpose, or non-infringement.
+//  / __/     Miami  University and  its affiliates shall not be liable
+// |_____|    for any damages  suffered by the  licensee as a result of
+//            using, modifying,  or distributing  this software  or its
+//            derivatives.
+//
+//  _         By using or  copying  this  Software,  Licensee  agree to
+// | |        abide  by the intellectual  property laws,  and all other
+// | |        applicable  laws of  the U.S.,  and the terms of the  GNU
+// | |___     General  Public  License  (version 3).  You  should  have
+// |_____|    received a  copy of the  GNU General Public License along
+//            with MUSE.  If not,  you may  download  copies  of GPL V3
+//            from <http://www.gnu.org/licenses/>.
+//
+// --------------------------------------------------------------------
+// Authors:   Dhananjai M. Rao          raodm@miamioh.edu
+//---------------------------------------------------------------------
+/**
+ * @file Kernel.h
+ * @brief Definition of Kernel, the interface of computations that
+ * are run by the CacheWorkers on the blocks they hold.
+ * @version 0.1
+ * @date 2022-05-02
+ */
+
+#include "Utilities.h"
+
+BEGIN_NAMESPACE(pc2l);
+
+/**
+ * The interface of a computation (or kernel) that is shipped to the
+ * CacheWorkers, rather than moving the data to the manager.  Code
+ * cannot be sent between processes. Instead, the same kernels are
+ * registered in the same order on all the processes (see
+ * System::registerKernel()), before the workers are started, and
+ * kernels are identified by their index in that order.
+ *
+ * A kernel operates on the raw bytes of a block.  The typed kernels
+ * in Algorithms.h implement this interface for specific operations
+ * on values of a given type.
+ */
+class Kernel {
+public:
+    /**
+     * The polymorphic destructor.
+     */
+    virtual ~Kernel() {}
+
+    /**
+     * The size (in bytes) of each value the kernel operates on.
+     *
+     * \return The size of a value.
+     */
+    virtual int valueSize() const = 0;
+
+    /**
+     * The size (in bytes) of the result produced by the kernel, if
+     * any.  Kernels that just update values produce no result.
+     *
+     * \return The size of the result, or zero if there is none.
+     */
+    virtual int resultSize() const { return 0; }
+
+    /**
+     * Determine if the kernel modifies the values it operates on.
+     *
+     * \return true if the kernel modifies values in place.
+     */
+    virtual bool modifiesValues() const = 0;
+
+    /**
+     * Apply the kernel to consecutive values in a block, combining
+     * them into the result (if any).
+     *
+     * \param[in,out] values The values in the block.
+     *
+     * \param[in] count The number of values to be processed.
+     *
+     * \param[in,out] result Buffer of resultSize() bytes with the
+     * result accumulated so far.
+     *
+     * \param[in,out] hasResult Flag to indicate if result holds a
+     * value.  It is false until the first value is accumulated.
+     */
+    virtual void apply(char* values, int count, char* result,
+                       bool& hasResult) = 0;
+
+    /**
+     * Combine a partial result (computed by a worker) into a result.
+     *
+     * \param[in,out] result The result to be updated.
+     *
+     * \param[in] partial The partial result to be combined.
+     */
+    virtual void combine(char*, const char*) const {}
+
+    /**
+     * Determine if the kernel defines an ordering of values, i.e.,
+     * it can be used for sorting (see sort() and less()).
+     *
+     * \return true if the kernel defines an ordering of values.
+     */
+    virtual bool ordersValues() const { return false; }
+
+    /**
+     * Compare two values using the ordering defined by the kernel.
+     *
+     * \param[in] a The first value.
+     *
+     * \param[in] b The second value.
+     *
+     * \return true if \p a is ordered before \p b.
+     */
+    virtual bool less(const char*, const char*) const { return false; }
+
+    /**
+     * Sort consecutive values using the ordering defined by the kernel.
+     *
+     * \param[in,out] values The values to be sorted.
+     *
+     * \param[in] count The number of values to be sorted.
+     */
+    virtual void sort(char*, long long) const {}
+
+    /**
+     * Determine if the kernel is a predicate on values, i.e., it can
+     * be used for searching (see test()).
+     *
+     * \return true if the kernel is a predicate on values.
+     */
+    virtual bool testsValues() const { return false; }
+
+    /**
+     * Test a value using the predicate defined by the kernel.
+     *
+     * \param[in] value The value to be tested.
+     *
+     * \return true if the value satisfies the predicate.
+     */
+    virtual bool test(const char*) const { return false; }
+};
+
+END_NAMESPACE(pc2l);
+
+#endif
@@ -731,6 +731,84 @@ bool MPI_IPROBE(int src, int tag, MPI_STATUS status);
 int MPI_SEND(const void* data, int count, int type, int rank, int tag);
 #endif
 
+/** \def MPI_REQUEST
+
+    \brief Compile time macro to map to MPI_Request (if MPI is
+    enabled) or to a dummy integer handle if MPI is unavailable.
+*/
+#ifdef MPI_FOUND
+#define MPI_REQUEST MPI_Request
+#else
+// MPI is not available
+typedef int MPI_REQUEST;
+#endif
+
+/** \def MPI_ISEND(data, count, type, rank, tag, request)
+
+    \brief Macro to map MPI_ISEND to MPI_Isend (if MPI is enabled) or
+    an empty method call if MPI is unavailable.
+
+    <p>This macro provides a convenient, conditionally defined macro
+    to refer to MPI_Isend method. If MPI is available, then MPI_ISEND
+    defaults to MPI_Isend on MPI_COMM_WORLD.  On the other hand, if
+    MPI is disabled then this macro simply reduces to a blank
+    method.  The buffer must not be modified (or freed) until the
+    request is reported as complete by MPI_TEST or MPI_WAIT.</p>
+
+    This macro can be used as shown below:
+
+    \code
+
+    #include "MPIHelper.h"
+
+    void someMethod() {
+        MPI_REQUEST request;
+        MPI_ISEND(msg, msg->getSize(), MPI_TYPE_CHAR, destRank, tag, request);
+        // ... do other work while the message is being sent ..
+        MPI_WAIT(request);
+    }
+    \endcode
+*/
+#ifdef MPI_FOUND
+#define MPI_ISEND(data, count, type, rank, tag, request)                 \
+    MPI_Isend(data, count, type, rank, tag, MPI_COMM_WORLD, &request)
+#else
+// MPI is not available
+int MPI_ISEND(const void* data, int count, int type, int rank, int tag,
+              MPI_REQUEST& request);
+#endif
+
+/** \brief A function to map MPI_TEST to MPI_Test (if MPI is enabled)
+    or a function that reports all requests as complete if MPI is
+    unavailable.
+
+    \param[in,out] request The request to be checked for completion.
+
+    \return True if the request has completed.
+*/
+#ifdef MPI_FOUND
+inline bool MPI_TEST(MPI_REQUEST& request) {
+    int flag = 0;
+    MPI_Test(&request, &flag, MPI_STATUS_IGNORE);
+    return (flag != 0);
+}
+#else
+// MPI is not available
+bool MPI_TEST(MPI_REQUEST& request);
+#endif
+
+/** \def MPI_WAIT(request)
+
+    \brief Macro to map MPI_WAIT to MPI_Wait (if MPI is enabled) or an
+    empty method call if MPI is unavailable.
+*/
+#ifdef MPI_FOUND
+#define MPI_WAIT(request) MPI_Wait(&request, MPI_STATUS_IGNORE)
+#else
+// MPI is not available
+#define MPI_WAIT(request)
+#endif
+
 /** \def MPI_WTIME
 
     \brief Macro to map MPI_WTIME to MPI::Wtime (if MPI is enabled) or
@@ -108,6 +108,20 @@ public:
         BLOCK_NOT_FOUND, /**< Requested block not found in cache */ 
         FINISH,          /**< Message to ask the worker to finish */
         PROBE_BLOCK,     /**< Check whether block is full without sending anything */
+        SHIFT,           /**< Shift part of a block, replying with the carry-out */
+        FILL_BLOCK,      /**< Lazily fill a range of blocks with a value */
+        DROP_DS,         /**< Free all blocks of a data structure */
+        COMPUTE,         /**< Run a kernel on blocks, replying with the result */
+        SORT,            /**< One of the steps of a distributed sample sort */
+        BITWISE,         /**< Count or combine the bits of bit-packed blocks */
+        CLONE_DS,        /**< Copy all blocks of a data structure to a new one */
+        SEARCH,          /**< Find or count values, replying with the result */
+        SAVE_DS,         /**< Write the blocks of a data structure to a file */
+        OPEN_DS,         /**< Map the blocks of a data structure from a file */
+        PATCH_BLOCK,     /**< Overwrite byte ranges of a block in place */
+        GATHER,          /**< Read values from several blocks, replying with them */
+        SCATTER,         /**< Write values into several blocks in place */
+        ENCODED_BLOCK,   /**< A block compressed by a BlockCodec */
         INVALID_MSG      /**< Just a placeholder */
     };
 
@@ -0,0 +1,144 @@
+#ifndef SERIALIZER_H
+#define SERIALIZER_H
+
+//---------------------------------------------------------------------
+//  ____ 
+// |  _ \    This file is part of  PC2L:  A Parallel & Cloud Computing 
+// | |_) |   Library <http://www.pc2lab.cec.miamioh.edu/pc2l>. PC2L is 
+// |  __/    free software: you can  redistribute it and/or  modify it
+// |_|       under the terms of the GNU  General Public License  (GPL)
+//           as published  by  the   Free  Software Foundation, either
+//           version 3 (GPL v3), or  (at your option) a later version.
+//    
+//   ____    PC2L  is distributed in the hope that it will  be useful,
+//  / ___|   but   WITHOUT  ANY  WARRANTY;  without  even  the IMPLIED
+// | |       WARRANTY of  MERCHANTABILITY  or FITNESS FOR A PARTICULAR
+// | |___    PURPOSE.
+//  \____| 
+//            Miami University and  the PC2Lab development team make no
+//            representations  or  warranties  about the suitability of
+//  ____      the software,  either  express  or implied, including but
+// |___ \     not limited to the implied warranties of merchantability,
+//   __) |    fitness  for a  particular  purpose, or non-infringement.
+//  / __/     Miami  University and  its affiliates shall not be liable
+// |_____|    for any damages  suffered by the  licensee as a result of
+//            using, modifying,  or distributing  this software  or its
+//            derivatives.
+//
+//  _         By using or  copying  this  Software,  Licensee  agree to
+// | |        abide  by the intellectual  property laws,  and all other
+// | |        applicable  laws of  the U.S.,  and the terms of the  GNU
+// | |___     General  Public  License  (version 3).  You  should  have
+// |_____|    received a  copy of the  GNU General Public License along
+//            with MUSE.  If not,  you may  download  copies  of GPL V3
+//            from <http://www.gnu.org/licenses/>.
+//
+// --------------------------------------------------------------------
+// Authors:   Dhananjai M. Rao          raodm@miamioh.edu
+//---------------------------------------------------------------------
+/**
+ * @file Serializer.h
+ * @brief Definition of Serializer, the trait used by data structures
+ * to convert values to and from the bytes stored in blocks.
+ * @version 0.1
+ * @date 2022-05-09
+ */
+
+#include <algorithm>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "Utilities.h"
+
+BEGIN_NAMESPACE(pc2l);
+
+/**
+ * The trait used to convert values of type T to and from the bytes
+ * that are stored in blocks and sent between processes.  By default,
+ * values are stored as their raw bytes, which is only meaningful for
+ * trivially copyable types.  Other types must specialize this trait,
+ * providing the same members, with fixedSize set to false.  For
+ * example, see the specializations for std::string and std::vector
+ * below.
+ *
+ * @tparam T the type of values to be serialized
+ */
+template <typename T>
+struct Serializer {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Values that are not trivially copyable need a "
+                  "pc2l::Serializer<T> specialization");
+
+    /** Flag to indicate that all values have the same size, sizeof(T) */
+    static const bool fixedSize = true;
+
+    /**
+     * The number of bytes needed to store a value
+     * @param value the value to be stored
+     * @return the number of bytes written by write()
+     */
+    static size_t size(const T& value) { return sizeof(T); }
+
+    /**
+     * Write the bytes of a value
+     * @param value the value to be written
+     * @param dest buffer with room for size(value) bytes
+     */
+    static void write(const T& value, char* dest) {
+        std::copy_n(reinterpret_cast<const char*>(&value), sizeof(T), dest);
+    }
+
+    /**
+     * Read a value from its bytes
+     * @param src the bytes written by write()
+     * @param len the number of bytes at src
+     * @return the value
+     */
+    static T read(const char* src, size_t len) {
+        T value;
+        std::copy_n(src, sizeof(T), reinterpret_cast<char*>(&value));
+        return value;
+    }
+};
+
+/**
+ * Strings are stored as their characters, without a terminator.
+ */
+template <>
+struct Serializer<std::string> {
+    static const bool fixedSize = false;
+    static size_t size(const std::string& value) { return value.size(); }
+    static void write(const std::string& value, char* dest) {
+        std::copy(value.begin(), value.end(), dest);
+    }
+    static std::string read(const char* src, size_t len) {
+        return std::string(src, len);
+    }
+};
+
+/**
+ * Vectors of trivially copyable values are stored as the raw bytes of
+ * their values.
+ */
+template <typename U, typename Alloc>
+struct Serializer<std::vector<U, Alloc>> {
+    static_assert(std::is_trivially_copyable<U>::value,
+                  "Values in vectors must be trivially copyable");
+    static const bool fixedSize = false;
+    static size_t size(const std::vector<U, Alloc>& value) {
+        return value.size() * sizeof(U);
+    }
+    static void write(const std::vector<U, Alloc>& value, char* dest) {
+        std::copy_n(reinterpret_cast<const char*>(value.data()),
+                    value.size() * sizeof(U), dest);
+    }
+    static std::vector<U, Alloc> read(const char* src, size_t len) {
+        std::vector<U, Alloc> value(len / sizeof(U));
+        std::copy_n(src, len, reinterpret_cast<char*>(value.data()));
+        return value;
+    }
+};
+
+END_NAMESPACE(pc2l);
+
+#endif
@@ -46,7 +46,11 @@
  */
 
 // namespace pc2l {
+#include <memory>
+#include <vector>
 #include "CacheManager.h"
+#include "Kernel.h"
+#include "BlockCodec.h"
 
 BEGIN_NAMESPACE(pc2l);
 
@@ -185,13 +189,44 @@ public:
      */
     unsigned int getBlockSize() noexcept;
 
+    /**
+     * Determine if this process is the manager-process and the
+     * workers are running, i.e., start() has been called but stop()
+     * has not been called yet.  Data structures can communicate with
+     * the workers only while the system is running.
+     * @return true if data structures can communicate with workers
+     */
+    bool isRunning() const noexcept;
+
 
     /**
      * Set the cache size of the System's cache manager
-     * @param cSize maximum size in bytes of CCM's cache
+     * @param cSize maximum size in bytes of CCM's cache, including
+     * the message header of each cached block
      */
     void setCacheSize(unsigned long long cSize) noexcept;
 
+    /**
+     * Set the maximum number of blocks the System's cache manager
+     * prefetches ahead of a detected access pattern
+     * @param depth number of blocks to prefetch; zero disables prefetching
+     */
+    void setPrefetchDepth(int depth) noexcept;
+
+    /**
+     * Set the maximum number of blocks per worker that the System's
+     * cache manager keeps in flight when streaming blocks to workers
+     * @param depth number of blocks per worker (at least 1)
+     */
+    void setStoreDepth(int depth) noexcept;
+
+    /**
+     * Set the scheme the System's cache manager uses to choose the
+     * blocks to be evicted from its cache
+     * @param strategy the eviction scheme
+     */
+    void setEvictionStrategy(CacheWorker::EvictionStrategy strategy);
+
     /**
      * Set the block size system-wide
      * @param bSize size of block in bytes
@@ -200,6 +235,42 @@ public:
 
     pc2l::CacheManager& cacheManager();
 
+    /**
+     * Register a kernel to be run on the CacheWorkers (see Kernel).
+     * Kernels must be registered in the same order on all processes,
+     * before start() is called.
+     * @param kernel the kernel to be registered. The System takes
+     * ownership of the kernel.
+     * @return the id of the kernel, to be used to run it
+     */
+    int registerKernel(Kernel* kernel);
+
+    /**
+     * Obtain a kernel that was registered earlier
+     * @param id the id of the kernel returned by registerKernel()
+     * @return the kernel with the given id
+     */
+    Kernel& getKernel(int id);
+
+    /**
+     * Register a codec to compress blocks (see BlockCodec), in
+     * addition to the built-in ones.  Like kernels, codecs must be
+     * registered in the same order on all processes, before start()
+     * is called.
+     * @param codec the codec to be registered. The System takes
+     * ownership of the codec.
+     * @return the id of the codec, to be used with Vector::setCodec()
+     */
+    int registerCodec(BlockCodec* codec);
+
+    /**
+     * Obtain a built-in codec or a codec that was registered earlier
+     * @param id one of BlockCodec::BuiltIn or the id returned by
+     * registerCodec()
+     * @return the codec with the given id
+     */
+    BlockCodec& getCodec(int id);
+
 protected:
     /**
      * Helper method to facilitate the PC2L system to run in
@@ -216,6 +287,24 @@ protected:
      */
     OpMode mode = InvalidMode;
 
+    /**
+     * Flag that is true on the manager-process between calls to
+     * start() and stop().  See isRunning().
+     */
+    bool running = false;
+
+    /**
+     * The kernels registered via registerKernel(), in the order they
+     * were registered.
+     */
+    std::vector<std::unique_ptr<Kernel>> kernels;
+
+    /**
+     * The codecs registered via registerCodec(), in the order they
+     * were registered.  Their ids follow those of the built-in codecs.
+     */
+    std::vector<std::unique_ptr<BlockCodec>> codecs;
+
 
     /**
      * The process-wide unique singleton instance of this class.
@@ -45,67 +45,355 @@
  * 
  */
 
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <type_traits>
 #include <unordered_map>
+#include <vector>
 #include "Worker.h"
 #include "CacheManager.h"
 #include "System.h"
 #include "MPIHelper.h"
 #include "Message.h"
+#include "Exception.h"
+#include "Future.h"
+#include "Serializer.h"
 
 
 // namespace pc2l {
 BEGIN_NAMESPACE(pc2l);
 
+/**
+ * The state of a distributed vector that does not depend on the type
+ * of its values, shared by the Vector specializations below.  A
+ * vector is identified by its dsTag (see CacheWorker::getKey()) and
+ * its values are held in blocks by the CacheManager and the
+ * CacheWorkers.  Values being appended are collected in a
+ * write-combining tail block until it is published by flush().
+ */
+class VectorBase {
+public:
+    /**
+     * The destructor.  The blocks of the vector are freed on the
+     * manager and the workers and its codec and write policy are
+     * reset, unless the system has been stopped already (see
+     * System::isRunning()).
+     */
+    virtual ~VectorBase();
+
+    int dsTag;
+
+    // the size (in bytes) of each block in vector. Potentially offer heterogeneous
+    // block sizes on different data structures later, but for now it is uniform.
+    unsigned long long blockSize;
+
+    // The number of elements currently in the vector
+    unsigned long long siz;
+
+    /**
+     * Returns size (in values, not blocks) of vector
+     * @return size (in values) of vector
+     */
+    unsigned long long size() const {
+        return siz;
+    }
+
+    /**
+     * Returns the number of blocks holding the values in the vector
+     * @return number of blocks (the last one may be partially filled)
+     */
+    size_t blockCount() const {
+        return (siz + elemsPerBlock - 1) / elemsPerBlock;
+    }
+
+    /**
+     * Erase all values from vector. All the blocks of the vector are
+     * freed in one pass (see CacheManager::dropDataStructure()),
+     * rather than erasing values one at a time.
+     */
+    void clear();
+
+    /**
+     * Publish the write-combining tail block (if any) to the
+     * CacheManager's cache.  This does not change the values of the
+     * vector, so it is allowed on const vectors.
+     */
+    virtual void flush() const;
+
+    /**
+     * Choose how changes to the values of the vector reach the
+     * workers (see CacheManager::setWritePolicy()).  The policy is
+     * kept by clear() and copied along with the vector.  Values
+     * written through iterators or writable block spans are always
+     * written back when their blocks are evicted.
+     * @param policy the write policy
+     */
+    void setWritePolicy(CacheManager::WritePolicy policy) {
+        System::get().cacheManager().setWritePolicy(dsTag, policy);
+    }
+
+protected:
+    /**
+     * Construct an empty vector with a new dsTag.
+     * @param bSize size in bytes of a block
+     * @param perBlock the number of values in each block
+     */
+    VectorBase(unsigned long long bSize, unsigned long long perBlock);
+
+    /**
+     * Copy constructor.  The blocks of \p other are copied by the
+     * workers holding them (see CacheManager::cloneDataStructure()),
+     * so the values are not sent through the manager.  The tail block
+     * of \p other is published first, so that it is copied as well.
+     * @param other the vector to be copied
+     */
+    VectorBase(const VectorBase& other);
+
+    /**
+     * Move constructor.  The blocks of \p other (including its tail
+     * block, which is published first) are taken over by this vector
+     * and \p other becomes an empty vector with a new dsTag.
+     * @param other the vector to be moved
+     */
+    VectorBase(VectorBase&& other);
+
+    /**
+     * Move assignment.  The blocks of this vector are freed and the
+     * blocks of \p other are taken over by this vector (see
+     * VectorBase(VectorBase&&)).
+     * @param other the vector to be moved
+     * @return this vector
+     */
+    VectorBase& operator=(VectorBase&& other);
+
+    /**
+     * Copy assignment.  The blocks of this vector are freed and
+     * replaced with copies of the blocks of \p other (see
+     * VectorBase(const VectorBase&)).
+     * @param other the vector to be copied
+     * @return this vector
+     */
+    VectorBase& operator=(const VectorBase& other);
+
+    /**
+     * The number of values in each block.  The specializations may
+     * also fix it at compile time (see Vector::valuesPerBlock()).
+     */
+    unsigned long long elemsPerBlock;
+
+    /**
+     * The write-combining block at the end of the vector that values
+     * are currently appended to, if any.  This block is not
+     * necessarily present in the CacheManager's cache until it is
+     * published by flush().
+     */
+    mutable MessagePtr tailBlock;
+
+    /**
+     * Discard the write-combining tail block (if any) without
+     * publishing it (see clear()).
+     */
+    virtual void dropTail();
+
+    /**
+     * Obtain the block with tag \p blockTag if it is the
+     * write-combining tail block or is present in the CacheManager's
+     * cache.
+     * @param blockTag tag of the block to be obtained
+     * @return the message containing the block, or nullptr if the
+     * block is not available locally
+     */
+    MessagePtr findBlock(size_t blockTag) const;
+
+    /**
+     * Obtain the block with tag \p blockTag.  If the block is not
+     * available locally (see findBlock()), it is fetched from the
+     * CacheWorker that owns it and added to the CacheManager's cache.
+     * @param blockTag tag of the block to be obtained
+     * @return the message containing the block
+     */
+    MessagePtr fetchBlock(size_t blockTag) const;
+
+    /**
+     * Record that the contents of block \p msg were modified in place,
+     * so that the CacheManager's cache holds (and eventually writes
+     * back) the modified block.
+     * @param msg the modified block
+     */
+    void markDirty(const MessagePtr& msg) {
+        System::get().cacheManager().markDirty(msg);
+    }
+
+    /**
+     * Record that \p len bytes at \p offset in block \p msg were
+     * modified in place, so that just those bytes are written back
+     * (see CacheManager::markDirty()).
+     * @param msg the modified block
+     * @param offset offset (in bytes) of the modified range
+     * @param len the number of bytes modified
+     */
+    void markDirty(const MessagePtr& msg, unsigned long long offset,
+                   unsigned long long len) {
+        System::get().cacheManager().markDirty(msg, offset, len);
+    }
+};
 
 /**
  * A distributed vector that runs across multiple machines
  * utilizing message passing through MPI. This initial  
  * implementation does not include any caching.
+ *
+ * Each block holds a whole number of values, so that no value
+ * straddles two blocks.
+ *
+ * @tparam T the type of values in the vector
+ * @tparam ElemsPerBlock the number of values in each block.  If it
+ * is zero (the default), the number of values is determined at
+ * runtime from the block size.  Otherwise, the index arithmetic is
+ * done with compile-time constants (shifts and masks if it is a
+ * power of two) and the configured block size is ignored.
+ * @tparam FixedSize true if all values are stored as sizeof(T) bytes
+ * (see Serializer).  Otherwise, the specialization below is used.
  */
-template <typename T>
-class Vector {
+template <typename T, unsigned long long ElemsPerBlock = 0,
+          bool FixedSize = Serializer<T>::fixedSize>
+class Vector : public VectorBase {
 public:
     /**
      * The default constructor.  Currently, the constructor calls the
      * workhorse
      */
-    Vector() : blockSize(System::get().getBlockSize()), siz(0), dsTag(System::get().dsCount++){ }
+    Vector() : Vector(System::get().getBlockSize()) { }
 
     /**
      *  Construct a vector by specifying the block size. Currently the
      *  workhorse constructor
-     * @param bSize size in bytes of a block
+     * @param bSize size in bytes of a block. It is rounded down to a
+     * multiple of sizeof(T).
      */
-    explicit Vector(unsigned long long bSize) : blockSize(bSize), siz(0), dsTag(System::get().dsCount++) { }
+    explicit Vector(unsigned long long bSize) :
+        VectorBase(alignBlockSize(bSize), alignBlockSize(bSize) / sizeof(T)) { }
+
     /**
-     * The destructor.
+     * Construct a vector holding the values in the range [\p first,
+     * \p last).  The values are packed into blocks that are streamed
+     * to their workers (see assign()).
+     * @param first iterator to the first value
+     * @param last iterator one past the last value
      */
-    virtual ~Vector() = default;
+    template <typename InputIt, typename = typename std::enable_if<
+                                    !std::is_integral<InputIt>::value>::type>
+    Vector(InputIt first, InputIt last) : Vector() {
+        storeRange(first, last);
+    }
 
-    int dsTag;
+    /**
+     * Construct a vector holding the values in \p values (see
+     * Vector(InputIt, InputIt)).
+     * @param values the values to be stored in the vector
+     */
+    explicit Vector(const std::vector<T>& values) :
+        Vector(values.begin(), values.end()) { }
 
-    // the size (in bytes) of each block in vector. Potentially offer heterogeneous
-    // block sizes on different data structures later, but for now it is uniform
-    unsigned long long blockSize;
+    /**
+     * Copy constructor (see VectorBase(const VectorBase&)).
+     * @param other the vector to be copied
+     */
+    Vector(const Vector& other) = default;
 
-    // The number of elements currently in the vector
-    unsigned long long siz;
+    /**
+     * Move constructor (see VectorBase(VectorBase&&)).
+     * @param other the vector to be moved
+     */
+    Vector(Vector&& other) = default;
 
     /**
-     * Returns size (in values, not blocks) of vector
-     * @return size (in values) of vector
+     * Copy assignment (see VectorBase::operator=(const VectorBase&)).
+     * @param other the vector to be copied
+     * @return this vector
      */
-    unsigned long long size() {
-        return siz;
+    Vector& operator=(const Vector& other) = default;
+
+    /**
+     * Move assignment (see VectorBase::operator=(VectorBase&&)).
+     * @param other the vector to be moved
+     * @return this vector
+     */
+    Vector& operator=(Vector&& other) = default;
+
+    /**
+     * Compress the blocks of the vector with a codec when they are
+     * sent to the workers (see CacheManager::setCodec()), so that the
+     * workers hold more values in the same memory.  Blocks that are
+     * already on the workers are compressed when they are next sent.
+     * BlockCodec::DELTA suits integers and BlockCodec::SHUFFLE_RLE
+     * suits floating point values.  The codec is kept by clear() and
+     * copied along with the vector.
+     * @param codec one of BlockCodec::BuiltIn or the id of a codec
+     * registered via System::registerCodec()
+     */
+    void setCodec(int codec) {
+        System::get().cacheManager().setCodec(dsTag, codec, sizeof(T));
     }
 
     /**
-     * Erase all values from vector
+     * Resize the vector to hold \p n values.  If the vector grows,
+     * the new values are set to \p value.  Blocks that hold only new
+     * values are filled lazily (see CacheManager::fillBlocks()), so
+     * growing the vector costs O(workers) messages rather than
+     * O(values).
+     * @param n the new size (in values) of the vector
+     * @param value the value of the newly added values, if any
      */
-    void clear() {
-        for (unsigned long long i = 0; i < siz; i++) {
-            erase(i);
+    void resize(unsigned long long n, const T& value = T()) {
+        if (n > siz) {
+            const unsigned long long perBlock = valuesPerBlock();
+            const size_t firstBlock = (siz + perBlock - 1) / perBlock;
+            // Set the new values in the partially filled last block
+            const unsigned long long partialEnd = std::min<unsigned long long>(
+                n, firstBlock * perBlock);
+            if (siz < partialEnd) {
+                MessagePtr msg = fetchBlock(blockOf(siz));
+                for (unsigned long long i = offsetOf(siz);
+                     i < offsetOf(siz) + partialEnd - siz; i++) {
+                    std::copy_n(reinterpret_cast<const char*>(&value), sizeof(T),
+                                msg->getPayload() + i * sizeof(T));
+                }
+                markDirty(msg, offsetOf(siz) * sizeof(T), (partialEnd - siz) * sizeof(T));
+            }
+            fill(firstBlock, (n + perBlock - 1) / perBlock, value);
         }
+        siz = n;
+    }
+
+    /**
+     * Replace the contents of the vector with \p n copies of \p
+     * value.  All the blocks are filled lazily (see resize()).
+     * @param n the new size (in values) of the vector
+     * @param value the value to be assigned to all the values
+     */
+    void assign(unsigned long long n, const T& value) {
+        fill(0, (n + valuesPerBlock() - 1) / valuesPerBlock(), value);
+        siz = n;
+    }
+
+    /**
+     * Replace the contents of the vector with the values in the range
+     * [\p first, \p last).  The values are packed into full blocks
+     * that are sent straight to the workers owning them, with several
+     * non-blocking sends in flight per worker (see
+     * CacheManager::streamBlock()), rather than inserting values one
+     * at a time.  The last, partially filled block becomes the
+     * write-combining tail block (see push_back()).
+     * @param first iterator to the first value
+     * @param last iterator one past the last value
+     */
+    template <typename InputIt, typename = typename std::enable_if<
+                                    !std::is_integral<InputIt>::value>::type>
+    void assign(InputIt first, InputIt last) {
+        clear();
+        storeRange(first, last);
     }
 
     /**
@@ -113,29 +401,36 @@ public:
      * @param index the index of the value to be erased
      */
     void erase(unsigned long long index) {
-        // move all of the blocks to the right of the index left by one
-        for (unsigned long long i = index; i < size() - 1; i++) { swap(i, i + 1); }
-        // clear the last index which is now junk
-//        size_t blockTag = index * sizeof(T) / blockSize;
-//        MessagePtr msg = cm.getBlock(CacheWorker::getKey(dsTag, blockTag));
-//        if (msg == nullptr) {
-//            // if block on remote cw, we have to fetch it
-//            const unsigned long long worldSize = System::get().worldSize();
-//            const int storedRank = (blockTag % (worldSize - 1)) + 1;
-//            MessagePtr m = Message::create(0, Message::GET_BLOCK, 0);
-//            m->dsTag = dsTag;
-//            m->blockTag = size() - 1;
-//            cm.send(m, destRank);
-//            msg = cm.recv(storedRank);
-//
-//        }
-        // I think I actually don't need to clear the last block
-        // if it's outside of size it's never going to be used
-        // double check with Dr. Rao
+        erase(index, index + 1);
+    }
 
-        // size() can now be decremented
-        siz--;
-        //TODO: maybe some check to see if it is successfully deleted?
+    /**
+     * Erase the values at indices [\p first, \p last).  The values
+     * after the erased range are moved left block by block (see
+     * shift()), starting with the last block of the vector, so that
+     * each block is touched only once.
+     * @param first index of the first value to be erased
+     * @param last index one past the last value to be erased
+     */
+    void erase(unsigned long long first, unsigned long long last) {
+        if (first > last || last > siz) {
+            throw PC2L_EXP("Range [%llu, %llu) is out of bounds (size %llu)",
+                           "Check range", first, last, siz);
+        }
+        if (last < siz) {
+            // the values falling off the left of each block are
+            // carried into the end of the previous block
+            std::vector<char> carry((last - first) * sizeof(T));
+            const size_t firstBlock = blockOf(first);
+            for (size_t blockTag = blockOf(siz - 1); blockTag > firstBlock;
+                 blockTag--) {
+                shift(blockTag, 0, false, carry);
+            }
+            shift(firstBlock, offsetOf(first) * sizeof(T), false, carry);
+        }
+        // values beyond the end are never used, so there is nothing
+        // to clear at the end of the vector
+        siz -= (last - first);
     }
 
     /**
@@ -145,32 +440,114 @@ public:
      * @return The value at \p index
      */
     T at(unsigned long long index) const {
-        CacheManager& cm  = System::get().cacheManager();
-        MessagePtr msg;
-        size_t blockTag = index*sizeof(T)  / blockSize;
-        // if the CacheManager's cache contains this block, just get it
-        msg = cm.getBlock(CacheWorker::getKey(dsTag, blockTag));
-        if (msg == nullptr) {
-            // otherwise, we have to get it from a remote cacheworker
-            const unsigned long long worldSize = System::get().worldSize();
-            const int storedRank = (blockTag % (worldSize - 1)) + 1;
-            msg = Message::create(0, Message::GET_BLOCK, 0);
-            msg->dsTag = dsTag;
-            msg->blockTag = blockTag;
-            cm.send(msg, storedRank);
-            msg = cm.recv(storedRank);
-            // then put the object at retrieved index into cache
-            cm.storeCacheBlock(msg);
-        }
+        MessagePtr msg = fetchBlock(blockOf(index));
         // get array of concatenated T-serializations
-        char* payload = msg->getPayload();
+        const char* payload = msg->getPayload();
         // offset into this array and extract correct portion
-        unsigned long long inBlockIdx = ((index * sizeof(T)) % blockSize);
-        char serializedObj[sizeof(T)];
-        // copy the block we need into a character array then reinterpret and deref it
-        std::copy(&payload[inBlockIdx], &payload[inBlockIdx + sizeof(T)], &serializedObj[0]);
-        auto ret = reinterpret_cast<T*>(serializedObj);
-        return *ret;
+        const unsigned long long inBlockIdx = offsetOf(index) * sizeof(T);
+        T ret;
+        // copy the value out of the block, which may not be aligned for T
+        std::copy_n(&payload[inBlockIdx], sizeof(T), reinterpret_cast<char*>(&ret));
+        return ret;
+    }
+
+    /**
+     * Copy \p count consecutive values starting at index \p first
+     * into \p out.  Unlike calling at() for each index, the range is
+     * walked one block at a time: each block is looked up (and, if
+     * needed, fetched from its CacheWorker) exactly once and the
+     * contiguous slice of the range it holds is copied out in one go.
+     * @param first index of the first value to be read
+     * @param count number of values to be read
+     * @param out buffer with room for at least \p count values
+     */
+    void read(unsigned long long first, unsigned long long count, T* out) const {
+        if (first + count > siz) {
+            throw PC2L_EXP("Range [%llu, %llu) is out of bounds (size %llu)",
+                           "Check range", first, first + count, siz);
+        }
+        char* dest = reinterpret_cast<char*>(out);
+        // walk the range of the values block by block
+        const unsigned long long last = first + count;
+        for (unsigned long long index = first; index < last;) {
+            const unsigned long long offset = offsetOf(index);
+            const unsigned long long n = std::min(last - index,
+                                                  valuesPerBlock() - offset);
+            MessagePtr msg = fetchBlock(blockOf(index));
+            std::copy_n(msg->getPayload() + offset * sizeof(T), n * sizeof(T), dest);
+            dest  += n * sizeof(T);
+            index += n;
+        }
+    }
+
+    /**
+     * Overwrite \p count consecutive values starting at index \p first
+     * with the values in \p in.  Similar to read(), the range is
+     * processed one block at a time.  Blocks whose valid portion is
+     * completely overwritten are not fetched from their CacheWorker
+     * at all.
+     * @param first index of the first value to be replaced
+     * @param count number of values to be replaced
+     * @param in the \p count values to be written
+     */
+    void write(unsigned long long first, unsigned long long count, const T* in) {
+        if (first + count > siz) {
+            throw PC2L_EXP("Range [%llu, %llu) is out of bounds (size %llu)",
+                           "Check range", first, first + count, siz);
+        }
+        CacheManager& cm = System::get().cacheManager();
+        const char* src = reinterpret_cast<const char*>(in);
+        const unsigned long long last = first + count;
+        for (unsigned long long index = first; index < last;) {
+            const size_t blockTag = blockOf(index);
+            const unsigned long long offset = offsetOf(index);
+            const unsigned long long n = std::min(last - index,
+                                                  valuesPerBlock() - offset);
+            const unsigned long long inBlockIdx = offset * sizeof(T);
+            const unsigned long long len = n * sizeof(T);
+            MessagePtr msg = findBlock(blockTag);
+            if (msg == nullptr && offset == 0 &&
+                (n == valuesPerBlock() || index + n == siz)) {
+                // all valid data in this block is being replaced, so
+                // there is no need to fetch the old block
+                msg = Message::create(blockSize, Message::STORE_BLOCK, 0);
+                msg->dsTag = dsTag;
+                msg->blockTag = blockTag;
+                std::copy_n(src, len, msg->getPayload());
+                cm.markDirty(msg);
+            } else {
+                if (msg == nullptr) {
+                    msg = fetchBlock(blockTag);
+                }
+                std::copy_n(src, len, msg->getPayload() + inBlockIdx);
+                cm.markDirty(msg, inBlockIdx, len);
+            }
+            src   += len;
+            index += n;
+        }
+    }
+
+    /**
+     * Append \p value to the end of the vector. Appended values are
+     * collected in a write-combining tail block that is published
+     * to the CacheManager's cache only when it fills up or when
+     * flush() is called.
+     * @param value value to be appended
+     */
+    void push_back(const T& value) {
+        append(&value, 1);
+    }
+
+    /**
+     * Append \p count values from \p values to the end of the vector.
+     * Similar to push_back(), the values are written directly into
+     * the write-combining tail block.
+     * @param values the values to be appended
+     * @param count number of values to be appended
+     */
+    void append(const T* values, unsigned long long count) {
+        appendValues(siz, reinterpret_cast<const char*>(values), count);
+        siz += count;
     }
 
     /**
@@ -179,35 +556,45 @@ public:
      * @param value value to be inserted
      */
     void insert(unsigned long long index, T value) {
-        CacheManager& cm = System::get().cacheManager();
-        // always insert into the cache manager's local cache - only move to cache worker on eviction
-        size_t blockTag = index * sizeof(T) / blockSize;
-        MessagePtr m = cm.getBlock(CacheWorker::getKey(dsTag, blockTag));
-        if (m == nullptr) {
-            // otherwise construct message and fill the buffer with data to insert
-            m = Message::create(blockSize, Message::STORE_BLOCK, 0);
-            m->dsTag = dsTag;
-            m->blockTag = blockTag;
+        insert(index, &value, 1);
+    }
+
+    /**
+     * Insert \p count values from \p values at vector index \p index.
+     * The values at and after \p index are moved right block by
+     * block (see shift()), so that each block is touched only once.
+     * @param index index where insert should occur
+     * @param values the values to be inserted
+     * @param count number of values to be inserted
+     */
+    void insert(unsigned long long index, const T* values, unsigned long long count) {
+        if (index == size()) {
+            // appending is handled by the write-combining tail block
+            append(values, count);
+            return;
+        } else if (index > size()) {
+            throw PC2L_EXP("Index %llu is out of bounds (size %llu)",
+                           "Check index", index, siz);
         }
-        char* block = m->getPayload();
-        // if we're not inserting at end of list
-        if (index < size()) {
-            // last value moves up one index
-            insert(size(), at(size()-1));
-            // all other values shifted right one index
-            for (auto i = index; i < size(); i++) {
-                replace(i, at(i-1));
-            }
-            // now we can insert
+        // the inserted values are the initial carry into the first
+        // block; the values falling off the right of each block are
+        // carried into the start of the next block
+        const char* serialized = reinterpret_cast<const char*>(values);
+        std::vector<char> carry(serialized, serialized + count * sizeof(T));
+        const size_t firstBlock = blockOf(index);
+        const size_t lastBlock  = blockOf(siz - 1);
+        shift(firstBlock, offsetOf(index) * sizeof(T), true, carry);
+        for (size_t blockTag = firstBlock + 1; blockTag <= lastBlock; blockTag++) {
+            shift(blockTag, 0, true, carry);
         }
-        // offset into the block array of serializations and insert val
-        unsigned long long inBlockIdx = ((index * sizeof(T)) % blockSize);
-        char* serialized = reinterpret_cast<char*>(&value);
-        std::copy(&serialized[0], &serialized[sizeof(T)], &block[inBlockIdx]);
-        // then put the object at retrieved index into cache
-        cm.storeCacheBlock(m);
-
-        siz++;
+        // the valid part of the carry out of the last block spills
+        // over into new block(s) at the end of the vector
+        const unsigned long long lastEnd = offsetOf(siz - 1) + 1;
+        if (count + lastEnd > valuesPerBlock()) {
+            appendValues((lastBlock + 1) * valuesPerBlock(), carry.data(),
+                         count + lastEnd - valuesPerBlock());
+        }
+        siz += count;
     }
 
     /**
@@ -216,26 +603,15 @@ public:
      * @param value
      */
     void replace(unsigned long long index, T value) {
-        // obtain world size() and compute destination rank for replacement
         CacheManager& cm = System::get().cacheManager();
-        auto& mgrCache = cm.managerCache();
-        size_t blockTag = index * sizeof(T) / blockSize;
-        MessagePtr m = cm.getBlock(CacheWorker::getKey(dsTag, blockTag));
-        if (m == nullptr) {
-            // if the block with this element is not in CM cache, get from remote CW
-            const int rank = (index % (System::get().worldSize() - 1)) + 1;
-            m = Message::create(0, Message::GET_BLOCK, 0);
-            m->dsTag = dsTag;
-            m->blockTag = blockTag;
-            cm.send(m, rank);
-            m = cm.recv(rank);
-        }
+        // get the block with this element, from a remote CW if needed
+        MessagePtr m = fetchBlock(blockOf(index));
         char* block = m->getPayload();
         // fill the buffer with new datum at correct in-blok offset
-        unsigned long long inBlockIdx = ((index * sizeof(T)) % blockSize);
+        const unsigned long long inBlockIdx = offsetOf(index) * sizeof(T);
         char* serialized = reinterpret_cast<char*>(&value);
         std::copy(&serialized[0], &serialized[sizeof(T)], &block[inBlockIdx]);
-        cm.storeCacheBlock(m);
+        cm.markDirty(m, inBlockIdx, sizeof(T));
     }
 
     /**
@@ -248,6 +624,1593 @@ public:
         replace(i, at(j));
         replace(j, oldI);
     }
+
+    /**
+     * Read the values at \p indices.  Unlike calling at() for each
+     * index, the indices whose blocks are not available locally are
+     * bucketed by the CacheWorker owning their block and each
+     * CacheWorker is asked, in one message, for just those values
+     * rather than whole blocks (see CacheManager::gatherValues()).
+     * @param indices the indices of the values to be read
+     * @return the values, in the order of \p indices
+     */
+    std::vector<T> gather(const std::vector<unsigned long long>& indices) const {
+        std::vector<T> values(indices.size());
+        std::vector<std::pair<size_t, size_t>> locations;
+        std::vector<size_t> remote;
+        for (size_t i = 0; i < indices.size(); i++) {
+            checkIndex(indices[i]);
+            const size_t blockTag = blockOf(indices[i]);
+            const size_t offset   = offsetOf(indices[i]) * sizeof(T);
+            if (tailBlock != nullptr && tailBlock->blockTag == blockTag) {
+                std::copy_n(tailBlock->getPayload() + offset, sizeof(T),
+                            reinterpret_cast<char*>(&values[i]));
+            } else {
+                locations.push_back(std::make_pair(blockTag, offset));
+                remote.push_back(i);
+            }
+        }
+        if (!remote.empty()) {
+            std::vector<T> fetched(remote.size());
+            System::get().cacheManager().gatherValues(
+                dsTag, locations, sizeof(T), reinterpret_cast<char*>(fetched.data()));
+            for (size_t i = 0; i < remote.size(); i++) {
+                values[remote[i]] = fetched[i];
+            }
+        }
+        return values;
+    }
+
+    /**
+     * Write \p values at \p indices (see gather()).  Values whose
+     * blocks are not available locally are sent, one message per
+     * CacheWorker, to be written in place without fetching their
+     * blocks (see CacheManager::scatterValues()).
+     * @param indices the indices of the values to be written
+     * @param values the values, in the order of \p indices
+     */
+    void scatter(const std::vector<unsigned long long>& indices,
+                 const std::vector<T>& values) {
+        if (indices.size() != values.size()) {
+            throw PC2L_EXP("%zu indices given for %zu values",
+                           "Pass one index per value", indices.size(),
+                           values.size());
+        }
+        std::vector<std::pair<size_t, size_t>> locations;
+        std::vector<T> remote;
+        for (size_t i = 0; i < indices.size(); i++) {
+            checkIndex(indices[i]);
+            const size_t blockTag = blockOf(indices[i]);
+            const size_t offset   = offsetOf(indices[i]) * sizeof(T);
+            if (tailBlock != nullptr && tailBlock->blockTag == blockTag) {
+                std::copy_n(reinterpret_cast<const char*>(&values[i]), sizeof(T),
+                            tailBlock->getPayload() + offset);
+            } else {
+                locations.push_back(std::make_pair(blockTag, offset));
+                remote.push_back(values[i]);
+            }
+        }
+        if (!remote.empty()) {
+            System::get().cacheManager().scatterValues(
+                dsTag, locations, sizeof(T),
+                reinterpret_cast<const char*>(remote.data()));
+        }
+    }
+
+    /**
+     * Start obtaining the block with tag \p blockTag without waiting
+     * for it (see CacheManager::requestBlock()).  Many blocks can be
+     * requested this way before waiting for any of them, hiding the
+     * latency of fetching them.  Requested blocks are added to the
+     * CacheManager's cache when they arrive, so the number of blocks
+     * in flight should not exceed the size of the cache (otherwise,
+     * get() may have to fetch a block again).  The vector must
+     * outlive the returned handle.
+     * @param blockTag tag of the block to be obtained
+     * @return handle whose get() returns the block
+     */
+    Future<MessagePtr> fetchBlockAsync(size_t blockTag) const {
+        MessagePtr msg = findBlock(blockTag);
+        if (msg != nullptr) {
+            return Future<MessagePtr>([] { return true; }, [msg] { return msg; });
+        }
+        CacheManager& cm = System::get().cacheManager();
+        cm.requestBlock(dsTag, blockTag);
+        const unsigned int ds = dsTag;
+        return Future<MessagePtr>(
+            [&cm, ds, blockTag] { return cm.pollBlock(ds, blockTag); },
+            [this, blockTag] { return fetchBlock(blockTag); });
+    }
+
+    /**
+     * Start obtaining the value at \p index without waiting for it
+     * (see fetchBlockAsync()).
+     * @param index index of the value
+     * @return handle whose get() returns the value at \p index
+     */
+    Future<T> atAsync(unsigned long long index) const {
+        checkIndex(index);
+        const Future<MessagePtr> block = fetchBlockAsync(blockOf(index));
+        const unsigned long long inBlockIdx = offsetOf(index) * sizeof(T);
+        return Future<T>([block] { return block.ready(); },
+                         [block, inBlockIdx] {
+                             T ret;
+                             std::copy_n(block.get()->getPayload() + inBlockIdx,
+                                         sizeof(T), reinterpret_cast<char*>(&ret));
+                             return ret;
+                         });
+    }
+
+    /**
+     * Replace the value at \p index with \p value without waiting for
+     * its block.  If the block is not available locally, only the
+     * value is sent to the CacheWorker that owns the block (see
+     * CacheManager::patchBlock()).  Messages to a worker are
+     * processed in order, so later reads observe the new value.
+     * Hence, the returned handle is always ready.
+     * @param index index of the value to be replaced
+     * @param value the new value
+     * @return handle for the completion of the replacement
+     */
+    Future<void> replaceAsync(unsigned long long index, const T& value) {
+        checkIndex(index);
+        MessagePtr msg = findBlock(blockOf(index));
+        const unsigned long long inBlockIdx = offsetOf(index) * sizeof(T);
+        if (msg != nullptr) {
+            std::copy_n(reinterpret_cast<const char*>(&value), sizeof(T),
+                        msg->getPayload() + inBlockIdx);
+            markDirty(msg, inBlockIdx, sizeof(T));
+        } else {
+            System::get().cacheManager().patchBlock(
+                dsTag, blockOf(index), inBlockIdx,
+                reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+        return Future<void>([] { return true; }, [] {});
+    }
+
+    /**
+     * A proxy for a value in a Vector, returned by operator[].  The
+     * block holding the value is looked up once, when the proxy is
+     * created, and is pinned (see Iterator) for as long as the proxy
+     * exists.  Assignments (including compound assignments such as
+     * +=) update the value in place in the cached block and mark the
+     * block as modified.  Hence, vec[i] += x accesses the block once,
+     * unlike replace(i, at(i) + x).
+     */
+    class Reference {
+    public:
+        /**
+         * Create a proxy for the value at \p value in \p block
+         * @param vec the vector holding the value
+         * @param block the block holding the value
+         * @param value pointer to the value in the block's payload
+         */
+        Reference(Vector* vec, MessagePtr block, char* value) :
+            vec(vec), block(block), value(value) {}
+
+        /** Obtain a copy of the value */
+        operator T() const {
+            T ret;
+            std::copy_n(value, sizeof(T), reinterpret_cast<char*>(&ret));
+            return ret;
+        }
+
+        Reference& operator=(const T& rhs) { return store(rhs); }
+        Reference& operator=(const Reference& rhs) { return store(T(rhs)); }
+
+        template <typename U> Reference& operator+=(const U& rhs) { return store(T(*this) + rhs); }
+        template <typename U> Reference& operator-=(const U& rhs) { return store(T(*this) - rhs); }
+        template <typename U> Reference& operator*=(const U& rhs) { return store(T(*this) * rhs); }
+        template <typename U> Reference& operator/=(const U& rhs) { return store(T(*this) / rhs); }
+        template <typename U> Reference& operator%=(const U& rhs) { return store(T(*this) % rhs); }
+        template <typename U> Reference& operator&=(const U& rhs) { return store(T(*this) & rhs); }
+        template <typename U> Reference& operator|=(const U& rhs) { return store(T(*this) | rhs); }
+        template <typename U> Reference& operator^=(const U& rhs) { return store(T(*this) ^ rhs); }
+        template <typename U> Reference& operator<<=(const U& rhs) { return store(T(*this) << rhs); }
+        template <typename U> Reference& operator>>=(const U& rhs) { return store(T(*this) >> rhs); }
+
+        Reference& operator++() { return *this += 1; }
+        Reference& operator--() { return *this -= 1; }
+        T operator++(int) { const T ret = *this; *this += 1; return ret; }
+        T operator--(int) { const T ret = *this; *this -= 1; return ret; }
+
+    private:
+        /**
+         * Overwrite the value in the block and mark the block as
+         * modified.
+         * @param rhs the new value
+         * @return this proxy
+         */
+        Reference& store(const T& rhs) {
+            std::copy_n(reinterpret_cast<const char*>(&rhs), sizeof(T), value);
+            vec->markDirty(block, value - block->getPayload(), sizeof(T));
+            return *this;
+        }
+
+        /** The vector holding the value */
+        Vector* vec;
+        /** The block holding the value, held to pin it */
+        MessagePtr block;
+        /** The value in the block's payload */
+        char* value;
+    };
+
+    /**
+     * Obtain a proxy for the value at \p index, which can be read or
+     * modified in place (see Reference).
+     * @param index index of the value
+     * @return a proxy for the value at \p index
+     */
+    Reference operator[](unsigned long long index) {
+        MessagePtr msg = fetchBlock(blockOf(index));
+        char* value = msg->getPayload() + offsetOf(index) * sizeof(T);
+        return Reference(this, msg, value);
+    }
+
+    /**
+     * Returns the value at \p index (see at())
+     * @param index index of the value
+     * @return The value at \p index
+     */
+    T operator[](unsigned long long index) const {
+        return at(index);
+    }
+
+    /**
+     * A random-access iterator over the values in a Vector.  The
+     * iterator pins the block containing the value it currently
+     * refers to by holding on to its MessagePtr.  Pinned blocks are
+     * not evicted from the CacheManager's cache and the iterator
+     * goes back to the CacheManager only when it is dereferenced
+     * after crossing a block boundary.  Hence, dereferencing values
+     * within a block is as cheap as accessing local memory.
+     *
+     * @tparam IsConst if true, the values are accessed read-only
+     */
+    template <bool IsConst>
+    class Iterator {
+        friend class Iterator<!IsConst>;
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = long long;
+        using pointer = typename std::conditional<IsConst, const T*, T*>::type;
+        using reference = typename std::conditional<IsConst, const T&, T&>::type;
+        using VectorPtr = typename std::conditional<IsConst, const Vector*, Vector*>::type;
+
+        /**
+         * Create an iterator that does not refer to any vector
+         */
+        Iterator() : vec(nullptr), index(0), first(0), last(0) {}
+
+        /**
+         * Create an iterator to the value at \p index in \p vec
+         * @param vec the vector to iterate over
+         * @param index index of the value the iterator refers to
+         */
+        Iterator(VectorPtr vec, unsigned long long index) :
+            vec(vec), index(index), first(0), last(0) {}
+
+        /**
+         * Convert an iterator into a const iterator
+         * @param other the iterator to be converted
+         */
+        template <bool C = IsConst, typename = typename std::enable_if<C>::type>
+        Iterator(const Iterator<false>& other) :
+            vec(other.vec), index(other.index), block(other.block),
+            first(other.first), last(other.last) {}
+
+        reference operator*() const { return *get(); }
+        pointer operator->() const { return get(); }
+        reference operator[](difference_type n) const { return *(*this + n); }
+
+        Iterator& operator++() { ++index; return *this; }
+        Iterator& operator--() { --index; return *this; }
+        Iterator operator++(int) { Iterator ret = *this; ++index; return ret; }
+        Iterator operator--(int) { Iterator ret = *this; --index; return ret; }
+        Iterator& operator+=(difference_type n) { index += n; return *this; }
+        Iterator& operator-=(difference_type n) { index -= n; return *this; }
+        Iterator operator+(difference_type n) const { Iterator ret = *this; return ret += n; }
+        Iterator operator-(difference_type n) const { Iterator ret = *this; return ret -= n; }
+        friend Iterator operator+(difference_type n, const Iterator& it) { return it + n; }
+        difference_type operator-(const Iterator& other) const { return index - other.index; }
+
+        bool operator==(const Iterator& other) const { return index == other.index; }
+        bool operator!=(const Iterator& other) const { return index != other.index; }
+        bool operator<(const Iterator& other) const { return index < other.index; }
+        bool operator>(const Iterator& other) const { return index > other.index; }
+        bool operator<=(const Iterator& other) const { return index <= other.index; }
+        bool operator>=(const Iterator& other) const { return index >= other.index; }
+
+    private:
+        /**
+         * Obtain a pointer to the value the iterator refers to,
+         * pinning the block containing it if it is not the block
+         * that is currently pinned.
+         */
+        pointer get() const {
+            if (index < first || index >= last) {
+                first = index - vec->offsetOf(index);
+                last  = first + vec->valuesPerBlock();
+                block = vec->fetchBlock(vec->blockOf(index));
+                // values may be modified through mutable iterators
+                markWritable(vec, block);
+            }
+            return reinterpret_cast<pointer>(block->getPayload()) + (index - first);
+        }
+
+        /**
+         * Mark a block reached via a mutable iterator as modified,
+         * since values may be written through the iterator.
+         * @param vec the vector being iterated over
+         * @param block the block the iterator refers to
+         */
+        static void markWritable(Vector*, const MessagePtr& block) {
+            System::get().cacheManager().markWritable(block);
+        }
+
+        /**
+         * Blocks reached via const iterators remain clean.
+         */
+        static void markWritable(const Vector*, const MessagePtr&) {
+        }
+
+        /** The vector being iterated over */
+        VectorPtr vec;
+        /** Index of the value the iterator refers to */
+        unsigned long long index;
+        /** The block that is currently pinned by this iterator */
+        mutable MessagePtr block;
+        /** Range of indices [first, last) held by the pinned block */
+        mutable unsigned long long first, last;
+    };
+
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, siz); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, siz); }
+    const_iterator cbegin() const { return const_iterator(this, 0); }
+    const_iterator cend() const { return const_iterator(this, siz); }
+
+    /**
+     * A view of the values held by one block of a Vector.  The view
+     * points directly into the payload of the cached block, which is
+     * pinned (see Iterator) for as long as the view exists.
+     *
+     * @tparam E the element type of the view (T or const T)
+     */
+    template <typename E>
+    class BlockSpan {
+    public:
+        /**
+         * Create a view of \p count values starting at \p data
+         * @param block the block holding the values
+         * @param first index (in the vector) of the first value in the view
+         * @param data pointer to the first value in the block's payload
+         * @param count number of values in the view
+         */
+        BlockSpan(MessagePtr block, unsigned long long first, E* data,
+                  unsigned long long count) :
+            block(block), first(first), ptr(data), count(count) {}
+
+        /** Index (in the vector) of the first value in the view */
+        unsigned long long firstIndex() const { return first; }
+        E* data() const { return ptr; }
+        unsigned long long size() const { return count; }
+        E* begin() const { return ptr; }
+        E* end() const { return ptr + count; }
+        E& operator[](unsigned long long i) const { return ptr[i]; }
+
+    private:
+        /** The block being viewed, held to pin it */
+        MessagePtr block;
+        /** Index of the first value in the view */
+        unsigned long long first;
+        /** The first value in the view */
+        E* ptr;
+        /** Number of values in the view */
+        unsigned long long count;
+    };
+
+    /**
+     * Obtain a read-only view of the values in the block with tag \p
+     * blockTag, without copying them.
+     * @param blockTag tag of the block to be viewed
+     * @return a view into the block's payload
+     */
+    BlockSpan<const T> blockSpan(size_t blockTag) const {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "Block spans require a trivially copyable type");
+        const unsigned long long perBlock = valuesPerBlock();
+        const unsigned long long first = blockTag * perBlock;
+        MessagePtr msg = fetchBlock(blockTag);
+        return BlockSpan<const T>(msg, first,
+                                  reinterpret_cast<const T*>(msg->getPayload()),
+                                  std::min(perBlock, siz - first));
+    }
+
+    /**
+     * Obtain a writable view of the values in the block with tag \p
+     * blockTag, without copying them.  The block is marked as
+     * modified.
+     * @param blockTag tag of the block to be viewed
+     * @return a view into the block's payload
+     */
+    BlockSpan<T> writableBlockSpan(size_t blockTag) {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "Block spans require a trivially copyable type");
+        const unsigned long long perBlock = valuesPerBlock();
+        const unsigned long long first = blockTag * perBlock;
+        MessagePtr msg = fetchBlock(blockTag);
+        System::get().cacheManager().markWritable(msg);
+        return BlockSpan<T>(msg, first, reinterpret_cast<T*>(msg->getPayload()),
+                            std::min(perBlock, siz - first));
+    }
+
+    /**
+     * Call \p fn for each block in the vector, in order, with a
+     * read-only pointer directly into the block's payload.
+     * @param fn callable as fn(firstIdx, const T* data, n) where
+     * firstIdx is the index of data[0] in the vector and n is the
+     * number of values at data
+     */
+    template <typename Fn>
+    void forEachBlock(Fn fn) const {
+        for (size_t blockTag = 0; blockTag < blockCount(); blockTag++) {
+            const BlockSpan<const T> span = blockSpan(blockTag);
+            fn(span.firstIndex(), span.data(), span.size());
+        }
+    }
+
+    /**
+     * Call \p fn for each block in the vector, in order, with a
+     * writable pointer directly into the block's payload.  Every
+     * block is marked as modified.
+     * @param fn callable as fn(firstIdx, T* data, n) where firstIdx
+     * is the index of data[0] in the vector and n is the number of
+     * values at data
+     */
+    template <typename Fn>
+    void forEachBlockWritable(Fn fn) {
+        for (size_t blockTag = 0; blockTag < blockCount(); blockTag++) {
+            const BlockSpan<T> span = writableBlockSpan(blockTag);
+            fn(span.firstIndex(), span.data(), span.size());
+        }
+    }
+
+    /**
+     * Returns the number of values held by each block
+     * @return number of values in each block
+     */
+    unsigned long long valuesPerBlock() const {
+        return (ElemsPerBlock != 0) ? ElemsPerBlock : elemsPerBlock;
+    }
+
+    /**
+     * Save the vector to files in directory \p dir, which is created
+     * if needed.  Each CacheWorker writes the blocks it owns to its
+     * own file in \p dir (on its node) in parallel, so the values are
+     * not sent through the manager (see
+     * CacheManager::saveDataStructure()).  The vector can be reopened
+     * with open() in a later run with the same number of processes.
+     * @param dir the directory to save the vector to
+     */
+    void save(const std::string& dir) {
+        flush();
+        const SavedInfo info = {sizeof(T), ElemsPerBlock, blockSize, siz};
+        System::get().cacheManager().saveDataStructure(
+            dsTag, dir, blockCount(),
+            std::string(reinterpret_cast<const char*>(&info), sizeof(info)));
+    }
+
+    /**
+     * Open a vector saved with save().  Each CacheWorker maps its
+     * file into memory and copies blocks out of it only when they
+     * are first used, so opening a vector does not read its values.
+     * @param dir the directory the vector was saved to
+     * @return the vector
+     */
+    static Vector open(const std::string& dir) {
+        Vector vec;
+        const std::string data =
+            System::get().cacheManager().openDataStructure(vec.dsTag, dir);
+        SavedInfo info;
+        std::copy_n(data.data(), std::min(data.size(), sizeof(info)),
+                    reinterpret_cast<char*>(&info));
+        if (data.size() != sizeof(info) || info.valueSize != sizeof(T) ||
+            info.elemsPerBlock != ElemsPerBlock) {
+            throw PC2L_EXP("%s does not hold a vector of this type",
+                           "Check the type of the vector", dir.c_str());
+        }
+        vec.blockSize     = info.blockSize;
+        vec.elemsPerBlock = info.blockSize / sizeof(T);
+        vec.siz           = info.siz;
+        return vec;
+    }
+
+private:
+    /**
+     * The state of a vector, other than its blocks, that is saved by
+     * save().
+     */
+    struct SavedInfo {
+        /** The size of each value, to detect mismatched types */
+        unsigned long long valueSize;
+        /** The ElemsPerBlock parameter of the vector */
+        unsigned long long elemsPerBlock;
+        /** The size (in bytes) of each block */
+        unsigned long long blockSize;
+        /** The number of values in the vector */
+        unsigned long long siz;
+    };
+
+    /**
+     * Returns the size (in bytes) of the blocks of the vector given
+     * a requested block size of \p bSize bytes.
+     * @param bSize the requested size (in bytes) of each block
+     * @return the largest multiple of sizeof(T) that is at most \p
+     * bSize, or the size of ElemsPerBlock values if it is not zero
+     */
+    static unsigned long long alignBlockSize(unsigned long long bSize) {
+        if (ElemsPerBlock != 0) {
+            return ElemsPerBlock * sizeof(T);
+        }
+        if (bSize < sizeof(T)) {
+            throw PC2L_EXP("Block size %llu cannot hold a value of size %zu",
+                           "Use a larger block size", bSize, sizeof(T));
+        }
+        return bSize - bSize % sizeof(T);
+    }
+
+    /**
+     * Throw an exception if \p index is not the index of a value in
+     * the vector
+     * @param index the index to be checked
+     */
+    void checkIndex(unsigned long long index) const {
+        if (index >= siz) {
+            throw PC2L_EXP("Index %llu is out of bounds (size %llu)",
+                           "Check index", index, siz);
+        }
+    }
+
+    /**
+     * Returns the tag of the block holding the value at \p index
+     * @param index index of a value in the vector
+     * @return tag of the block holding the value
+     */
+    size_t blockOf(unsigned long long index) const {
+        return index / valuesPerBlock();
+    }
+
+    /**
+     * Returns the position of the value at \p index in its block
+     * @param index index of a value in the vector
+     * @return position (in values, not bytes) of the value in its block
+     */
+    unsigned long long offsetOf(unsigned long long index) const {
+        return index % valuesPerBlock();
+    }
+
+    /**
+     * Store the values in the range [\p first, \p last) into an empty
+     * vector (see assign()).
+     * @param first iterator to the first value
+     * @param last iterator one past the last value
+     */
+    template <typename InputIt>
+    void storeRange(InputIt first, InputIt last) {
+        CacheManager& cm = System::get().cacheManager();
+        const unsigned long long perBlock = valuesPerBlock();
+        for (size_t blockTag = 0; first != last; blockTag++) {
+            MessagePtr msg = Message::create(blockSize, Message::STORE_BLOCK, 0);
+            msg->dsTag = dsTag;
+            msg->blockTag = blockTag;
+            char* dest = msg->getPayload();
+            unsigned long long count = 0;
+            for (; (count < perBlock) && (first != last); ++first, count++) {
+                const T value = *first;
+                std::copy_n(reinterpret_cast<const char*>(&value), sizeof(T),
+                            dest + count * sizeof(T));
+            }
+            siz += count;
+            if (count < perBlock) {
+                tailBlock = msg;
+            } else {
+                cm.streamBlock(msg);
+            }
+        }
+    }
+
+    /**
+     * Lazily fill the blocks [\p firstBlock, \p lastBlock) with
+     * copies of \p value (see CacheManager::fillBlocks()).
+     * @param firstBlock the first block to be filled
+     * @param lastBlock one past the last block to be filled
+     * @param value the value to be repeated in the blocks
+     */
+    void fill(size_t firstBlock, size_t lastBlock, const T& value) {
+        if (firstBlock >= lastBlock) {
+            return;
+        }
+        if (tailBlock != nullptr && tailBlock->blockTag >= firstBlock &&
+            tailBlock->blockTag < lastBlock) {
+            // the tail block is being overwritten by the fill
+            tailBlock = nullptr;
+        }
+        System::get().cacheManager().fillBlocks(
+            dsTag, firstBlock, lastBlock, blockSize,
+            reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    /**
+     * Write \p count serialized values from \p src into the
+     * write-combining tail block(s) starting at index \p index.
+     * @param index index in the vector where writing starts
+     * @param src the bytes of the values to be written
+     * @param count number of values to be written
+     */
+    void appendValues(unsigned long long index, const char* src,
+                      unsigned long long count) {
+        const unsigned long long last = index + count;
+        while (index < last) {
+            const unsigned long long offset = offsetOf(index);
+            const unsigned long long n = std::min(last - index,
+                                                  valuesPerBlock() - offset);
+            openTail(blockOf(index), offset * sizeof(T));
+            std::copy_n(src, n * sizeof(T), tailBlock->getPayload() + offset * sizeof(T));
+            src   += n * sizeof(T);
+            index += n;
+            if (offset + n == valuesPerBlock()) {
+                // the tail block is full; publish it to the cache
+                flush();
+            }
+        }
+    }
+
+    /**
+     * Shift the contents of the block with tag \p blockTag, from
+     * byte \p offset onwards, by carry.size() bytes (see
+     * CacheWorker::shiftBlock()).  If the block is available locally
+     * it is shifted in place.  Otherwise, a SHIFT message is sent
+     * to the CacheWorker that owns the block so that it is shifted
+     * there without moving the block over the network.
+     * @param blockTag tag of the block to be shifted
+     * @param offset byte offset in the block where shifting starts
+     * @param right if true, shift right (insert). Otherwise shift left (erase)
+     * @param carry the bytes carried into this block. On return, it
+     * contains the bytes carried out of the block.
+     */
+    void shift(size_t blockTag, int offset, bool right, std::vector<char>& carry) {
+        std::vector<char> carryOut(carry.size());
+        MessagePtr msg = findBlock(blockTag);
+        if (msg != nullptr) {
+            CacheWorker::shiftBlock(msg->getPayload(), msg->getPayloadSize(),
+                                    offset, right, carry.data(), carry.size(),
+                                    carryOut.data());
+            markDirty(msg, offset, msg->getPayloadSize() - offset);
+            carry.swap(carryOut);
+            return;
+        }
+        CacheManager& cm = System::get().cacheManager();
+        const int storedRank = CacheWorker::getOwnerRank(blockTag);
+        const int info[2] = {offset, right};
+        msg = Message::create(sizeof(info) + carry.size(), Message::SHIFT, 0);
+        msg->dsTag = dsTag;
+        msg->blockTag = blockTag;
+        std::copy_n(reinterpret_cast<const char*>(info), sizeof(info), msg->getPayload());
+        std::copy(carry.begin(), carry.end(), msg->getPayload() + sizeof(info));
+        cm.send(msg, storedRank);
+        // the reply carries the bytes that were shifted out of the
+        // block. Blocks being prefetched may arrive ahead of it.
+        msg = cm.recv(storedRank, true, Message::SHIFT);
+        if (msg->getPayloadSize() != static_cast<int>(carry.size())) {
+            throw PC2L_EXP("Block %zu of data structure %d not found on rank %d",
+                           "Vector is inconsistent", blockTag, dsTag, storedRank);
+        }
+        std::copy_n(msg->getPayload(), carry.size(), carry.begin());
+    }
+
+    /**
+     * Make the block with tag \p blockTag the write-combining tail
+     * block, publishing the current tail block if it is a different
+     * block.
+     * @param blockTag tag of the block to become the tail block
+     * @param inBlockIdx offset in the block where the first value
+     * is to be appended. If it is zero, the block does not exist yet.
+     */
+    void openTail(size_t blockTag, unsigned long long inBlockIdx) {
+        if (tailBlock != nullptr && tailBlock->blockTag == blockTag) {
+            return;
+        }
+        flush();
+        if (inBlockIdx == 0) {
+            // appending starts a brand new block
+            tailBlock = Message::create(blockSize, Message::STORE_BLOCK, 0);
+            tailBlock->dsTag = dsTag;
+            tailBlock->blockTag = blockTag;
+        } else {
+            // appending to a partially filled block
+            tailBlock = fetchBlock(blockTag);
+        }
+    }
+
+};
+
+/**
+ * A distributed vector of values that do not all have the same size
+ * in bytes, such as std::string (see Serializer).  Each block holds a
+ * fixed number of values, serialized one after the other, preceded
+ * by an index with the byte offset of each value in the block:
+ *
+ *     count | offset[0] ... offset[count] | serialized values
+ *
+ * so that a single value is read without deserializing the rest of
+ * its block.  Consequently, blocks vary in size.  Operations that
+ * rely on values having a fixed size (the algorithms in
+ * Algorithms.h, block spans, and lazily filled blocks) are not
+ * available for these vectors.
+ *
+ * @tparam T the type of values in the vector
+ * @tparam ElemsPerBlock the number of values in each block.  If it
+ * is zero (the default), the configured block size divided by
+ * sizeof(T) is used, treating sizeof(T) as an estimate of the size
+ * of a serialized value.
+ */
+template <typename T, unsigned long long ElemsPerBlock>
+class Vector<T, ElemsPerBlock, false> : public VectorBase {
+public:
+    /**
+     * The default constructor.
+     */
+    Vector() : Vector(System::get().getBlockSize()) { }
+
+    /**
+     * Construct a vector by specifying the (estimated) block size.
+     * @param bSize estimated size in bytes of a block. It determines
+     * the number of values in each block, unless ElemsPerBlock is
+     * not zero.
+     */
+    explicit Vector(unsigned long long bSize) :
+        VectorBase(bSize, (ElemsPerBlock != 0) ? ElemsPerBlock :
+                   std::max<unsigned long long>(1, bSize / sizeof(T))),
+        tailTag(0), tailOpen(false) { }
+
+    /**
+     * Construct a vector holding the values in the range [\p first,
+     * \p last) (see assign()).
+     * @param first iterator to the first value
+     * @param last iterator one past the last value
+     */
+    template <typename InputIt, typename = typename std::enable_if<
+                                    !std::is_integral<InputIt>::value>::type>
+    Vector(InputIt first, InputIt last) : Vector() {
+        assign(first, last);
+    }
+
+    /**
+     * Construct a vector holding the values in \p values.
+     * @param values the values to be stored in the vector
+     */
+    explicit Vector(const std::vector<T>& values) :
+        Vector(values.begin(), values.end()) { }
+
+    /**
+     * Copy constructor (see VectorBase(const VectorBase&)).
+     * @param other the vector to be copied
+     */
+    Vector(const Vector& other) = default;
+
+    /**
+     * Move constructor (see VectorBase(VectorBase&&)).
+     * @param other the vector to be moved
+     */
+    Vector(Vector&& other) = default;
+
+    /**
+     * Copy assignment (see VectorBase::operator=(const VectorBase&)).
+     * @param other the vector to be copied
+     * @return this vector
+     */
+    Vector& operator=(const Vector& other) = default;
+
+    /**
+     * Move assignment (see VectorBase::operator=(VectorBase&&)).
+     * @param other the vector to be moved
+     * @return this vector
+     */
+    Vector& operator=(Vector&& other) = default;
+
+    /**
+     * Returns the number of values held by each block
+     * @return number of values in each block
+     */
+    unsigned long long valuesPerBlock() const {
+        return (ElemsPerBlock != 0) ? ElemsPerBlock : elemsPerBlock;
+    }
+
+    /**
+     * Replace the contents of the vector with the values in the
+     * range [\p first, \p last).  Full blocks are streamed to their
+     * workers as they are packed (see CacheManager::streamBlock()).
+     * @param first iterator to the first value
+     * @param last iterator one past the last value
+     */
+    template <typename InputIt>
+    void assign(InputIt first, InputIt last) {
+        clear();
+        for (; first != last; ++first) {
+            appendValue(*first, true);
+        }
+    }
+
+    /**
+     * Returns the value at \p index.  Only the requested value is
+     * deserialized from its block.
+     * @param index index of the value
+     * @return The value at \p index
+     */
+    T at(unsigned long long index) const {
+        if (index >= siz) {
+            throw PC2L_EXP("Index %llu is out of bounds (size %llu)",
+                           "Check index", index, siz);
+        }
+        const size_t blockTag = index / valuesPerBlock();
+        const unsigned long long pos = index % valuesPerBlock();
+        if (tailOpen && tailTag == blockTag) {
+            return tail[pos];
+        }
+        MessagePtr msg = fetchBlock(blockTag);
+        const char* payload = msg->getPayload();
+        const unsigned int start = indexEntry(payload, pos + 1);
+        const unsigned int end   = indexEntry(payload, pos + 2);
+        return Serializer<T>::read(payload + dataOffset(payload) + start,
+                                   end - start);
+    }
+
+    /**
+     * Returns the value at \p index (see at()).
+     * @param index index of the value
+     * @return The value at \p index
+     */
+    T operator[](unsigned long long index) const {
+        return at(index);
+    }
+
+    /**
+     * Add \p value to the end of the vector.  Values are collected
+     * in a write-combining tail block until it is full or flush() is
+     * called.
+     * @param value value to be appended
+     */
+    void push_back(const T& value) {
+        appendValue(value, false);
+    }
+
+    /**
+     * Publish the write-combining tail block (if any) to the
+     * CacheManager's cache.  The values in the tail block are
+     * serialized into a block first.
+     */
+    void flush() const override {
+        if (tailOpen) {
+            System::get().cacheManager().markDirty(encode(tailTag, tail));
+            tail.clear();
+            tailOpen = false;
+        }
+    }
+
+    /**
+     * Replace the value at \p index with \p value.  Since the size of
+     * the value may change, its block is serialized again.
+     * @param index index of the value to be replaced
+     * @param value the new value
+     */
+    void replace(unsigned long long index, const T& value) {
+        if (index >= siz) {
+            throw PC2L_EXP("Index %llu is out of bounds (size %llu)",
+                           "Check index", index, siz);
+        }
+        const size_t blockTag = index / valuesPerBlock();
+        std::vector<T> values = loadBlock(blockTag);
+        values[index % valuesPerBlock()] = value;
+        storeBlock(blockTag, values);
+    }
+
+    /**
+     * Insert \p value at vector index \p index.
+     * @param index index where insert should occur
+     * @param value value to be inserted
+     */
+    void insert(unsigned long long index, const T& value) {
+        insert(index, &value, 1);
+    }
+
+    /**
+     * Insert \p count values from \p values at vector index \p index.
+     * Each block from the one holding \p index onwards is
+     * deserialized and stored once, with the values that overflow it
+     * carried into the next block.
+     * @param index index where insert should occur
+     * @param values the values to be inserted
+     * @param count number of values to be inserted
+     */
+    void insert(unsigned long long index, const T* values, unsigned long long count) {
+        if (index > siz) {
+            throw PC2L_EXP("Index %llu is out of bounds (size %llu)",
+                           "Check index", index, siz);
+        }
+        const unsigned long long perBlock = valuesPerBlock();
+        const size_t lastBlock = blockCount();
+        std::vector<T> carry(values, values + count);
+        unsigned long long pos = index % perBlock;
+        for (size_t blockTag = index / perBlock; !carry.empty(); blockTag++, pos = 0) {
+            std::vector<T> block;
+            if (blockTag < lastBlock) {
+                block = loadBlock(blockTag);
+            }
+            block.insert(block.begin() + pos, carry.begin(), carry.end());
+            carry.clear();
+            if (block.size() > perBlock) {
+                carry.assign(block.begin() + perBlock, block.end());
+                block.erase(block.begin() + perBlock, block.end());
+            }
+            storeBlock(blockTag, block);
+        }
+        siz += count;
+    }
+
+    /**
+     * Erase the value at \p index
+     * @param index the index of the value to be erased
+     */
+    void erase(unsigned long long index) {
+        erase(index, index + 1);
+    }
+
+    /**
+     * Erase the values at indices [\p first, \p last).  Starting with
+     * the last block, each block is deserialized and stored once,
+     * with the values at its beginning carried into the previous
+     * block.
+     * @param first index of the first value to be erased
+     * @param last index one past the last value to be erased
+     */
+    void erase(unsigned long long first, unsigned long long last) {
+        if (first > last || last > siz) {
+            throw PC2L_EXP("Range [%llu, %llu) is out of bounds (size %llu)",
+                           "Check range", first, last, siz);
+        }
+        const unsigned long long perBlock = valuesPerBlock();
+        const unsigned long long count = last - first;
+        const size_t firstBlock = first / perBlock;
+        std::vector<T> carry;
+        for (size_t blockTag = blockCount(); count > 0 && blockTag-- > firstBlock;) {
+            std::vector<T> block = loadBlock(blockTag);
+            block.insert(block.end(), carry.begin(), carry.end());
+            // values [skip, skip + count) move out of this block: they
+            // are erased from the first block or carried into the
+            // previous one
+            const size_t skip  = (blockTag == firstBlock) ? first % perBlock : 0;
+            const size_t taken = std::min<size_t>(count, block.size() - skip);
+            carry.assign(block.begin() + skip, block.begin() + skip + taken);
+            block.erase(block.begin() + skip, block.begin() + skip + taken);
+            if (block.size() > perBlock) {
+                block.erase(block.begin() + perBlock, block.end());
+            }
+            storeBlock(blockTag, block);
+        }
+        siz -= count;
+    }
+
+    /**
+     * A read-only random access iterator over the values of the
+     * vector.  Dereferencing it returns a copy of the value (see
+     * at()), since values are not stored in their deserialized form.
+     */
+    class const_iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = long long;
+        using pointer = const T*;
+        using reference = T;
+
+        const_iterator() : vec(nullptr), index(0) {}
+        const_iterator(const Vector* vec, unsigned long long index) :
+            vec(vec), index(index) {}
+
+        T operator*() const { return vec->at(index); }
+        T operator[](difference_type n) const { return vec->at(index + n); }
+
+        const_iterator& operator++() { ++index; return *this; }
+        const_iterator& operator--() { --index; return *this; }
+        const_iterator operator++(int) { const_iterator ret = *this; ++index; return ret; }
+        const_iterator operator--(int) { const_iterator ret = *this; --index; return ret; }
+        const_iterator& operator+=(difference_type n) { index += n; return *this; }
+        const_iterator& operator-=(difference_type n) { index -= n; return *this; }
+        const_iterator operator+(difference_type n) const { const_iterator ret = *this; return ret += n; }
+        const_iterator operator-(difference_type n) const { const_iterator ret = *this; return ret -= n; }
+        difference_type operator-(const const_iterator& other) const { return index - other.index; }
+
+        bool operator==(const const_iterator& other) const { return index == other.index; }
+        bool operator!=(const const_iterator& other) const { return index != other.index; }
+        bool operator<(const const_iterator& other) const { return index < other.index; }
+
+    private:
+        /** The vector being iterated over */
+        const Vector* vec;
+        /** Index of the value the iterator refers to */
+        unsigned long long index;
+    };
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, siz); }
+    const_iterator cbegin() const { return const_iterator(this, 0); }
+    const_iterator cend() const { return const_iterator(this, siz); }
+
+private:
+    /**
+     * The values of the write-combining block at the end of the
+     * vector that push_back() currently appends to, if tailOpen is
+     * true.  They are serialized into a block by flush().
+     */
+    mutable std::vector<T> tail;
+
+    /** The tag of the write-combining tail block */
+    mutable size_t tailTag;
+
+    /** Flag to indicate if the write-combining tail block is in use */
+    mutable bool tailOpen;
+
+    /**
+     * Discard the values in the write-combining tail block (if any)
+     * without publishing them (see clear()).
+     */
+    void dropTail() override {
+        tail.clear();
+        tailOpen = false;
+    }
+
+    /**
+     * Append \p value to the write-combining tail block, publishing
+     * the block once it is full.
+     * @param value the value to be appended
+     * @param stream if true, full blocks are streamed directly to
+     * their workers (see CacheManager::streamBlock()) rather than
+     * added to the CacheManager's cache.
+     */
+    void appendValue(const T& value, bool stream) {
+        const size_t blockTag = siz / valuesPerBlock();
+        if (!tailOpen || tailTag != blockTag) {
+            flush();
+            if (siz % valuesPerBlock() != 0) {
+                // appending to a partially filled block
+                tail = loadBlock(blockTag);
+            }
+            tailTag  = blockTag;
+            tailOpen = true;
+        }
+        tail.push_back(value);
+        siz++;
+        if (tail.size() == valuesPerBlock()) {
+            if (stream) {
+                System::get().cacheManager().streamBlock(encode(tailTag, tail));
+                tail.clear();
+                tailOpen = false;
+            } else {
+                flush();
+            }
+        }
+    }
+
+    /**
+     * Returns entry \p i of the index at the start of a block (entry
+     * 0 is the number of values in the block).
+     * @param payload the block
+     * @param i the index entry to be returned
+     * @return the index entry
+     */
+    static unsigned int indexEntry(const char* payload, unsigned long long i) {
+        unsigned int entry;
+        // the index may not be aligned for unsigned int
+        std::copy_n(payload + i * sizeof(entry), sizeof(entry),
+                    reinterpret_cast<char*>(&entry));
+        return entry;
+    }
+
+    /**
+     * Returns the position of the first serialized value in a block
+     * @param payload the block
+     * @return the size (in bytes) of the index at the start of the block
+     */
+    static unsigned long long dataOffset(const char* payload) {
+        return (indexEntry(payload, 0) + 2) * sizeof(unsigned int);
+    }
+
+    /**
+     * Serialize \p values into a block with tag \p blockTag
+     * @param blockTag the tag of the block
+     * @param values the values to be stored in the block
+     * @return the message containing the block
+     */
+    MessagePtr encode(size_t blockTag, const std::vector<T>& values) const {
+        std::vector<unsigned int> index(values.size() + 2);
+        index[0] = values.size();
+        for (size_t i = 0; i < values.size(); i++) {
+            index[i + 2] = index[i + 1] + Serializer<T>::size(values[i]);
+        }
+        const unsigned long long indexSize = index.size() * sizeof(unsigned int);
+        MessagePtr msg = Message::create(indexSize + index.back(),
+                                         Message::STORE_BLOCK, 0);
+        msg->dsTag = dsTag;
+        msg->blockTag = blockTag;
+        char* payload = msg->getPayload();
+        std::copy_n(reinterpret_cast<const char*>(index.data()), indexSize, payload);
+        for (size_t i = 0; i < values.size(); i++) {
+            Serializer<T>::write(values[i], payload + indexSize + index[i + 1]);
+        }
+        return msg;
+    }
+
+    /**
+     * Deserialize the values in the block with tag \p blockTag
+     * @param blockTag the tag of the block
+     * @return the values in the block
+     */
+    std::vector<T> loadBlock(size_t blockTag) const {
+        if (tailOpen && tailTag == blockTag) {
+            return tail;
+        }
+        MessagePtr msg = fetchBlock(blockTag);
+        const char* payload = msg->getPayload();
+        const unsigned long long first = blockTag * valuesPerBlock();
+        // values beyond the end of the vector are stale
+        const unsigned long long count = std::min<unsigned long long>(
+            indexEntry(payload, 0), siz - first);
+        const char* data = payload + dataOffset(payload);
+        std::vector<T> values;
+        values.reserve(count);
+        for (unsigned long long i = 0; i < count; i++) {
+            const unsigned int start = indexEntry(payload, i + 1);
+            values.push_back(Serializer<T>::read(data + start,
+                                                 indexEntry(payload, i + 2) - start));
+        }
+        return values;
+    }
+
+    /**
+     * Serialize \p values into the block with tag \p blockTag,
+     * replacing its current contents.
+     * @param blockTag the tag of the block
+     * @param values the values to be stored in the block
+     */
+    void storeBlock(size_t blockTag, const std::vector<T>& values) {
+        if (tailOpen && tailTag == blockTag) {
+            tail = values;
+        } else {
+            System::get().cacheManager().markDirty(encode(blockTag, values));
+        }
+    }
+};
+
+/**
+ * A distributed vector of bits.  Values are packed 8 per byte, so
+ * that blocks hold 8 times as many values as Vector<char>.  Counting
+ * the bits that are set and combining two vectors with &, |, or ^ are
+ * performed word by word on the workers owning the blocks (see
+ * CacheWorker::bitwiseBlocks()), without moving blocks over the
+ * network.  The bits in a block beyond the end of the vector are
+ * always zero, which lets these operations process whole words.
+ *
+ * @tparam ElemsPerBlock the number of values in each block.  If it
+ * is zero (the default), it is determined at runtime from the block
+ * size.  Otherwise, it must be a multiple of 64.
+ */
+template <unsigned long long ElemsPerBlock>
+class Vector<bool, ElemsPerBlock, true> : public VectorBase {
+    static_assert(ElemsPerBlock % 64 == 0,
+                  "Bit vectors hold a multiple of 64 values per block");
+public:
+    /**
+     * The default constructor.
+     */
+    Vector() : Vector(System::get().getBlockSize()) { }
+
+    /**
+     * Construct a vector by specifying the block size.
+     * @param bSize size in bytes of a block. It is rounded down to a
+     * multiple of 8 bytes, so that blocks hold whole words.
+     */
+    explicit Vector(unsigned long long bSize) :
+        VectorBase(alignBlockSize(bSize), alignBlockSize(bSize) * 8) { }
+
+    /**
+     * Construct a vector holding the values in the range [\p first,
+     * \p last).
+     * @param first iterator to the first value
+     * @param last iterator one past the last value
+     */
+    template <typename InputIt, typename = typename std::enable_if<
+                                    !std::is_integral<InputIt>::value>::type>
+    Vector(InputIt first, InputIt last) : Vector() {
+        for (; first != last; ++first) {
+            push_back(*first);
+        }
+    }
+
+    /**
+     * Construct a vector holding the values in \p values.
+     * @param values the values to be stored in the vector
+     */
+    explicit Vector(const std::vector<bool>& values) :
+        Vector(values.begin(), values.end()) { }
+
+    /**
+     * Copy constructor (see VectorBase(const VectorBase&)).
+     * @param other the vector to be copied
+     */
+    Vector(const Vector& other) = default;
+
+    /**
+     * Move constructor (see VectorBase(VectorBase&&)).
+     * @param other the vector to be moved
+     */
+    Vector(Vector&& other) = default;
+
+    /**
+     * Copy assignment (see VectorBase::operator=(const VectorBase&)).
+     * @param other the vector to be copied
+     * @return this vector
+     */
+    Vector& operator=(const Vector& other) = default;
+
+    /**
+     * Move assignment (see VectorBase::operator=(VectorBase&&)).
+     * @param other the vector to be moved
+     * @return this vector
+     */
+    Vector& operator=(Vector&& other) = default;
+
+    /**
+     * Returns the number of values held by each block.  The size (in
+     * bytes) of each block is always a multiple of 8 bytes.
+     * @return number of values in each block
+     */
+    unsigned long long valuesPerBlock() const {
+        return elemsPerBlock;
+    }
+
+    /**
+     * Resize the vector to hold \p n values.  If the vector grows,
+     * the new values are set to \p value (see set()).
+     * @param n the new size (in values) of the vector
+     * @param value the value of the newly added values, if any
+     */
+    void resize(unsigned long long n, bool value = false) {
+        const unsigned long long bits = valuesPerBlock();
+        if (n > siz) {
+            setBits(siz, n, value, blockCount());
+        } else if (n < siz) {
+            // keep the bits beyond the end of the vector zero
+            if (n % bits != 0) {
+                setBits(n, std::min(siz, (n / bits + 1) * bits), false, blockCount());
+            }
+            if (tailBlock != nullptr && tailBlock->blockTag * bits >= n) {
+                tailBlock = nullptr;
+            }
+        }
+        siz = n;
+    }
+
+    /**
+     * Replace the contents of the vector with \p n copies of \p
+     * value.  The blocks are filled lazily (see CacheManager::fillBlocks()).
+     * @param n the new size (in values) of the vector
+     * @param value the value to be assigned to all the values
+     */
+    void assign(unsigned long long n, bool value) {
+        clear();
+        resize(n, value);
+    }
+
+    /**
+     * Set the values at indices [\p first, \p last) to \p value.
+     * Whole blocks in the range are filled lazily on the workers
+     * (see CacheManager::fillBlocks()); only the partially covered
+     * blocks at either end are modified on the manager.
+     * @param first index of the first value to be set
+     * @param last index one past the last value to be set
+     * @param value the value to be set
+     */
+    void set(unsigned long long first, unsigned long long last, bool value) {
+        if (first > last || last > siz) {
+            throw PC2L_EXP("Range [%llu, %llu) is out of bounds (size %llu)",
+                           "Check range", first, last, siz);
+        }
+        setBits(first, last, value, blockCount());
+    }
+
+    /**
+     * Returns the value at \p index
+     * @param index index of the value
+     * @return The value at \p index
+     */
+    bool at(unsigned long long index) const {
+        if (index >= siz) {
+            throw PC2L_EXP("Index %llu is out of bounds (size %llu)",
+                           "Check index", index, siz);
+        }
+        const unsigned long long bit = index % valuesPerBlock();
+        MessagePtr msg = fetchBlock(index / valuesPerBlock());
+        return (msg->getPayload()[bit / 8] >> (bit % 8)) & 1;
+    }
+
+    /**
+     * Replace value at \p index with \p value
+     * @param index index of the value
+     * @param value the new value
+     */
+    void replace(unsigned long long index, bool value) {
+        (*this)[index] = value;
+    }
+
+    /**
+     * A proxy for a bit in a Vector, returned by operator[].  The
+     * block holding the bit is pinned for as long as the proxy exists
+     * and assignments mark the block as modified.
+     */
+    class Reference {
+    public:
+        /**
+         * Create a proxy for the bit selected by \p mask in \p byte
+         * @param vec the vector holding the bit
+         * @param block the block holding the bit
+         * @param byte the byte in the block's payload holding the bit
+         * @param mask the mask selecting the bit in \p byte
+         */
+        Reference(Vector* vec, MessagePtr block, char* byte, char mask) :
+            vec(vec), block(block), byte(byte), mask(mask) {}
+
+        /** Obtain the value of the bit */
+        operator bool() const { return (*byte & mask) != 0; }
+
+        Reference& operator=(bool rhs) { return store(rhs); }
+        Reference& operator=(const Reference& rhs) { return store(bool(rhs)); }
+        Reference& operator&=(bool rhs) { return store(bool(*this) & rhs); }
+        Reference& operator|=(bool rhs) { return store(bool(*this) | rhs); }
+        Reference& operator^=(bool rhs) { return store(bool(*this) ^ rhs); }
+
+        /** Invert the bit */
+        void flip() { store(!bool(*this)); }
+
+    private:
+        /**
+         * Overwrite the bit and mark the block as modified.
+         * @param rhs the new value
+         * @return this proxy
+         */
+        Reference& store(bool rhs) {
+            *byte = rhs ? (*byte | mask) : (*byte & ~mask);
+            vec->markDirty(block, byte - block->getPayload(), 1);
+            return *this;
+        }
+
+        /** The vector holding the bit */
+        Vector* vec;
+        /** The block holding the bit, held to pin it */
+        MessagePtr block;
+        /** The byte in the block's payload holding the bit */
+        char* byte;
+        /** The mask selecting the bit in byte */
+        char mask;
+    };
+
+    /**
+     * Obtain a proxy for the value at \p index, which can be read or
+     * modified in place (see Reference).
+     * @param index index of the value
+     * @return a proxy for the value at \p index
+     */
+    Reference operator[](unsigned long long index) {
+        if (index >= siz) {
+            throw PC2L_EXP("Index %llu is out of bounds (size %llu)",
+                           "Check index", index, siz);
+        }
+        const unsigned long long bit = index % valuesPerBlock();
+        MessagePtr msg = fetchBlock(index / valuesPerBlock());
+        return Reference(this, msg, msg->getPayload() + bit / 8, 1 << (bit % 8));
+    }
+
+    /**
+     * Returns the value at \p index (see at())
+     * @param index index of the value
+     * @return The value at \p index
+     */
+    bool operator[](unsigned long long index) const {
+        return at(index);
+    }
+
+    /**
+     * Add \p value to the end of the vector.  Values are written
+     * into a write-combining tail block until it is full or flush()
+     * is called.
+     * @param value value to be appended
+     */
+    void push_back(bool value) {
+        const size_t blockTag = siz / valuesPerBlock();
+        if (tailBlock == nullptr || tailBlock->blockTag != blockTag) {
+            flush();
+            tailBlock = (siz % valuesPerBlock() == 0) ? newBlock(blockTag) :
+                fetchBlock(blockTag);
+        }
+        const unsigned long long bit = siz % valuesPerBlock();
+        if (value) {
+            tailBlock->getPayload()[bit / 8] |= (1 << (bit % 8));
+        }
+        if (++siz % valuesPerBlock() == 0) {
+            // the tail block is full; publish it to the cache
+            flush();
+        }
+    }
+
+    /**
+     * Returns the number of values that are true.  The bits are
+     * counted by the workers owning the blocks.
+     * @return the number of values that are true
+     */
+    unsigned long long count() const {
+        flush();
+        return System::get().cacheManager().bitwise(
+            dsTag, CacheWorker::BIT_COUNT, dsTag, blockCount(), blockSize);
+    }
+
+    /**
+     * Combine each value with the value at the same index in \p
+     * other using logical and.  The blocks are combined by the
+     * workers owning them (both vectors' blocks with the same tag
+     * are owned by the same worker).
+     * @param other a vector of the same size
+     * @return this vector
+     */
+    Vector& operator&=(const Vector& other) {
+        return combine(other, CacheWorker::BIT_AND);
+    }
+
+    /**
+     * Combine each value with the value at the same index in \p
+     * other using logical or (see operator&=()).
+     * @param other a vector of the same size
+     * @return this vector
+     */
+    Vector& operator|=(const Vector& other) {
+        return combine(other, CacheWorker::BIT_OR);
+    }
+
+    /**
+     * Combine each value with the value at the same index in \p
+     * other using exclusive or (see operator&=()).
+     * @param other a vector of the same size
+     * @return this vector
+     */
+    Vector& operator^=(const Vector& other) {
+        return combine(other, CacheWorker::BIT_XOR);
+    }
+
+private:
+    /**
+     * Returns the size (in bytes) of the blocks of the vector given
+     * a requested block size of \p bSize bytes.
+     * @param bSize the requested size (in bytes) of each block
+     * @return the largest multiple of 8 that is at most \p bSize, or
+     * the size of ElemsPerBlock bits if it is not zero
+     */
+    static unsigned long long alignBlockSize(unsigned long long bSize) {
+        if (ElemsPerBlock != 0) {
+            return ElemsPerBlock / 8;
+        }
+        if (bSize < 8) {
+            throw PC2L_EXP("Block size %llu cannot hold a word of bits",
+                           "Use a larger block size", bSize);
+        }
+        return bSize - bSize % 8;
+    }
+
+    /**
+     * Set the values at indices [\p first, \p last) to \p value.
+     * @param first index of the first value to be set
+     * @param last index one past the last value to be set
+     * @param value the value to be set
+     * @param existing the number of blocks that exist. Blocks after
+     * them are created.
+     */
+    void setBits(unsigned long long first, unsigned long long last, bool value,
+                 size_t existing) {
+        const unsigned long long bits = valuesPerBlock();
+        const size_t firstFull = (first + bits - 1) / bits, lastFull = last / bits;
+        if (firstFull > lastFull) {
+            // the range is inside one block
+            setBlockBits(first / bits, first % bits, last % bits, value, existing);
+            return;
+        }
+        if (first % bits != 0) {
+            setBlockBits(first / bits, first % bits, bits, value, existing);
+        }
+        if (firstFull < lastFull) {
+            if (tailBlock != nullptr && tailBlock->blockTag >= firstFull &&
+                tailBlock->blockTag < lastFull) {
+                // the tail block is being overwritten by the fill
+                tailBlock = nullptr;
+            }
+            const char byte = value ? ~0 : 0;
+            System::get().cacheManager().fillBlocks(dsTag, firstFull, lastFull,
+                                                    blockSize, &byte, 1);
+        }
+        if (last % bits != 0) {
+            setBlockBits(lastFull, 0, last % bits, value, existing);
+        }
+    }
+
+    /**
+     * Set the bits [\p from, \p to) of the block with tag \p blockTag
+     * to \p value.
+     * @param blockTag tag of the block
+     * @param from the first bit to be set
+     * @param to one past the last bit to be set
+     * @param value the value to be set
+     * @param existing the number of blocks that exist (see setBits())
+     */
+    void setBlockBits(size_t blockTag, unsigned long long from, unsigned long long to,
+                      bool value, size_t existing) {
+        MessagePtr msg = (blockTag < existing) ? fetchBlock(blockTag) :
+            newBlock(blockTag);
+        char* payload = msg->getPayload();
+        for (unsigned long long bit = from; bit < to; bit++) {
+            const char mask = 1 << (bit % 8);
+            payload[bit / 8] = value ? (payload[bit / 8] | mask) :
+                (payload[bit / 8] & ~mask);
+        }
+        if (blockTag < existing) {
+            markDirty(msg, from / 8, (to + 7) / 8 - from / 8);
+        } else {
+            markDirty(msg);
+        }
+    }
+
+    /**
+     * Combine the values with those in \p other on the workers (see
+     * CacheManager::bitwise()).
+     * @param other a vector of the same size
+     * @param op the operation to be performed
+     * @return this vector
+     */
+    Vector& combine(const Vector& other, CacheWorker::BitOp op) {
+        if (other.siz != siz || other.blockSize != blockSize) {
+            throw PC2L_EXP("Vectors of sizes %llu and %llu cannot be combined",
+                           "Use vectors of the same size", siz, other.siz);
+        }
+        flush();
+        other.flush();
+        System::get().cacheManager().bitwise(dsTag, op, other.dsTag,
+                                             blockCount(), blockSize);
+        return *this;
+    }
+
+    /**
+     * Create a block with tag \p blockTag with all bits cleared
+     * @param blockTag tag of the block
+     * @return the message containing the block
+     */
+    MessagePtr newBlock(size_t blockTag) const {
+        MessagePtr msg = Message::create(blockSize, Message::STORE_BLOCK, 0);
+        msg->dsTag = dsTag;
+        msg->blockTag = blockTag;
+        std::fill_n(msg->getPayload(), blockSize, 0);
+        return msg;
+    }
 };
 
 END_NAMESPACE(pc2l);
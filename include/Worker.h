@@ -44,6 +44,7 @@
  * @date 2021-04-23
  */
 
+#include <utility>
 #include <vector>
 #include "Message.h"
 
@@ -113,6 +114,42 @@ public:
      */
     void send(MessagePtr msgPtr, const int destRank = 0);
 
+    /**
+     * Helper method to send a message (binary blob) to a given
+     * destination process without blocking.  This worker holds on to
+     * the message until the send completes.  Hence, the caller need
+     * not keep the message around, but it must not modify the
+     * message until the send has completed (see completeSends()).
+     *
+     * \param[in] msgPtr Pointer to the message to be sent. If there
+     * isn't a message in he supplied pointer then this method does
+     * not perform any operations.
+     *
+     * \param[in] destRank The destination rank to where the message
+     * is to be sent.
+     */
+    void isend(MessagePtr msgPtr, const int destRank = 0);
+
+    /**
+     * Helper method to release messages whose non-blocking sends (see
+     * isend()) have completed.
+     *
+     * \param[in] wait If this flag is true then this method blocks
+     * until all of the pending sends have completed.
+     */
+    void completeSends(const bool wait = false);
+
+    /**
+     * Helper method to wait for the oldest non-blocking sends (see
+     * isend()) to complete until at most \p maxPending sends remain
+     * in progress.  This bounds the memory held by messages being
+     * sent, while still keeping several sends in flight.
+     *
+     * \param[in] maxPending The maximum number of sends that may
+     * remain in progress.
+     */
+    void limitSends(const size_t maxPending);
+
     /**
      * Helper method to receive a message (binary blob), optionaly
      * from a given source-rank.
@@ -153,6 +190,13 @@ private:
      *
      */
      std::vector<char> recvBuf;
+
+    /**
+     * The non-blocking sends (see isend()) that have not yet been
+     * completed along with the messages being sent.  The messages
+     * are held here so that they are not deleted while being sent.
+     */
+    std::vector<std::pair<MPI_REQUEST, MessagePtr>> pendingSends;
 };
 
 END_NAMESPACE(pc2l);
@@ -66,5 +66,6 @@
 #include "ArgParser.h"
 #include "System.h"
 #include "Vector.h"
+#include "Algorithms.h"
 
 #endif
@@ -0,0 +1,240 @@
+#ifndef BLOCK_CODEC_CPP
+#define BLOCK_CODEC_CPP
+
+//---------------------------------------------------------------------
+//  ____ 
+// |  _ \    This file is part of  PC2L:  A Parallel & Cloud Computing 
+// | |_) |   Library <http://www.pc2lab.cec.miamioh.edu/pc2l>. PC2L is 
+// |  __/    free software: you can  redistribute it and/or  modify it
+// |_|       under the terms of the GNU  General Public License  (GPL)
+//           as published  by  the   Free  Software Foundation, either
+//           version 3 (GPL v3), or  (at your option) a later version.
+//    
+//   ____    PC2L  is distributed in the hope that it will  be useful,
+//  / ___|   but   WITHOUT  ANY  WARRANTY;  without  even  the IMPLIED
+// | |       WARRANTY of  MERCHANTABILITY  or FITNESS FOR A PARTICULAR
+// | |___    PURPOSE.
+//  \____| 
+//            Miami University and  the PC2Lab development team make no
+//            representations  or  warranties  about the suitability of
+//  ____      the software,  either  express  or implied, including but
+// |___ \     not limited to the implied warranties of merchantability,
+//   __) |    fitness  for a  particular  purpose, or non-infringement.
+//  / __/     Miami  University and  its affiliates shall not be liable
+// |_____|    for any damages  suffered by the  licensee as a result of
+//            using, modifying,  or distributing  this software  or its
+//            derivatives.
+//
+//  _         By using or  copying  this  Software,  Licensee  agree to
+// | |        abide  by the intellectual  property laws,  and all other
+// | |        applicable  laws of  the U.S.,  and the terms of the  GNU
+// | |___     General  Public  License  (version 3).  You  should  have
+// |_____|    received a  copy of the  GNU General Public License along
+//            with MUSE.  If not,  you may  download  copies  of GPL V3
+//            from <http://www.gnu.org/licenses/>.
+//
+// --------------------------------------------------------------------
+// Authors:   Dhananjai M. Rao          raodm@miamioh.edu
+//---------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstdint>
+#include "BlockCodec.h"
+#include "System.h"
+#include "Exception.h"
+
+BEGIN_NAMESPACE(pc2l);
+
+MessagePtr
+BlockCodec::encodeBlock(const MessagePtr& block, int codec, int valueSize) {
+    const int size = block->getPayloadSize();
+    std::vector<char> data(sizeof(Header));
+    if (!System::get().getCodec(codec).encode(block->getPayload(), size,
+                                               valueSize, data) ||
+        (data.size() >= static_cast<size_t>(size))) {
+        return block;
+    }
+    const Header header = {codec, valueSize, size};
+    std::copy_n(reinterpret_cast<const char*>(&header), sizeof(header),
+                data.begin());
+    MessagePtr msg = Message::create(data.size(), Message::ENCODED_BLOCK,
+                                     block->srcRank);
+    msg->dsTag    = block->dsTag;
+    msg->blockTag = block->blockTag;
+    std::copy(data.begin(), data.end(), msg->getPayload());
+    return msg;
+}
+
+MessagePtr
+BlockCodec::decodeBlock(const MessagePtr& msg) {
+    Header header;
+    std::copy_n(msg->getPayload(), sizeof(header),
+                reinterpret_cast<char*>(&header));
+    MessagePtr block = Message::create(header.blockSize, Message::STORE_BLOCK,
+                                       msg->srcRank);
+    block->dsTag    = msg->dsTag;
+    block->blockTag = msg->blockTag;
+    System::get().getCodec(header.codec).decode(
+        msg->getPayload() + sizeof(header), msg->getPayloadSize() - sizeof(header),
+        header.valueSize, block->getPayload(), header.blockSize);
+    return block;
+}
+
+// Helper to read a little-endian signed integer of the given size
+static int64_t
+readValue(const char* src, int valueSize) {
+    switch (valueSize) {
+    case 1: return *reinterpret_cast<const int8_t*>(src);
+    case 2: { int16_t v; std::copy_n(src, 2, reinterpret_cast<char*>(&v)); return v; }
+    case 4: { int32_t v; std::copy_n(src, 4, reinterpret_cast<char*>(&v)); return v; }
+    default: { int64_t v; std::copy_n(src, 8, reinterpret_cast<char*>(&v)); return v; }
+    }
+}
+
+bool
+DeltaCodec::encode(const char* block, int size, int valueSize,
+                   std::vector<char>& out) const {
+    if (valueSize != 1 && valueSize != 2 && valueSize != 4 && valueSize != 8) {
+        return false;
+    }
+    // Differences are computed modulo 2^64, so that decoding is
+    // exact even when they overflow.
+    const int count = size / valueSize;
+    std::vector<uint64_t> deltas(count);
+    uint64_t prev = 0;
+    int64_t minDelta = 0;
+    for (int i = 0; i < count; i++) {
+        const uint64_t value = readValue(block + i * valueSize, valueSize);
+        deltas[i] = value - prev;
+        prev      = value;
+        minDelta  = (i == 0) ? deltas[i] :
+            std::min(minDelta, static_cast<int64_t>(deltas[i]));
+    }
+    uint64_t maxResidual = 0;
+    for (uint64_t& delta : deltas) {
+        delta -= minDelta;
+        maxResidual = std::max(maxResidual, delta);
+    }
+    const char bits = (maxResidual == 0) ? 0 : 64 - __builtin_clzll(maxResidual);
+    // The reference and bit width are followed by the packed
+    // residuals and the bytes after the last whole value.
+    const size_t start = out.size();
+    out.resize(start + sizeof(minDelta) + 1 + (count * bits + 7) / 8);
+    std::copy_n(reinterpret_cast<const char*>(&minDelta), sizeof(minDelta),
+                out.begin() + start);
+    out[start + sizeof(minDelta)] = bits;
+    unsigned char* packed =
+        reinterpret_cast<unsigned char*>(out.data() + start + sizeof(minDelta) + 1);
+    for (int i = 0, pos = 0; i < count; i++) {
+        uint64_t residual = deltas[i];
+        for (int left = bits; left > 0; ) {
+            const int shift = pos % 8, len = std::min(8 - shift, left);
+            packed[pos / 8] |= (residual & ((1u << len) - 1)) << shift;
+            residual >>= len;
+            pos  += len;
+            left -= len;
+        }
+    }
+    out.insert(out.end(), block + count * valueSize, block + size);
+    return true;
+}
+
+void
+DeltaCodec::decode(const char* data, int size, int valueSize,
+                   char* block, int blockSize) const {
+    int64_t minDelta;
+    std::copy_n(data, sizeof(minDelta), reinterpret_cast<char*>(&minDelta));
+    const int bits = data[sizeof(minDelta)];
+    const unsigned char* packed =
+        reinterpret_cast<const unsigned char*>(data + sizeof(minDelta) + 1);
+    const int count = blockSize / valueSize;
+    uint64_t value  = 0;
+    for (int i = 0, pos = 0; i < count; i++) {
+        uint64_t residual = 0;
+        for (int done = 0; done < bits; ) {
+            const int shift = pos % 8, len = std::min(8 - shift, bits - done);
+            residual |= static_cast<uint64_t>((packed[pos / 8] >> shift) &
+                                              ((1u << len) - 1)) << done;
+            pos  += len;
+            done += len;
+        }
+        value += minDelta + residual;
+        // Values are little-endian, so their low bytes come first
+        std::copy_n(reinterpret_cast<const char*>(&value), valueSize,
+                    block + i * valueSize);
+    }
+    const int tail = blockSize - count * valueSize;
+    std::copy_n(data + size - tail, tail, block + count * valueSize);
+}
+
+bool
+ShuffleRleCodec::encode(const char* block, int size, int valueSize,
+                        std::vector<char>& out) const {
+    if (valueSize < 1) {
+        return false;
+    }
+    // Byte b of value i is moved to position b * count + i
+    const int count = size / valueSize;
+    std::vector<char> shuffled(block + count * valueSize, block + size);
+    shuffled.insert(shuffled.begin(), count * valueSize, 0);
+    for (int i = 0; i < count; i++) {
+        for (int b = 0; b < valueSize; b++) {
+            shuffled[b * count + i] = block[i * valueSize + b];
+        }
+    }
+    // Each run starts with a control byte: 0..127 is followed by
+    // 1..128 literal bytes, while 128..255 is followed by a single
+    // byte that is repeated 2..129 times.
+    for (int pos = 0; pos < size; ) {
+        int run = 1;
+        while ((pos + run < size) && (run < 129) &&
+               (shuffled[pos + run] == shuffled[pos])) {
+            run++;
+        }
+        if (run > 1) {
+            out.push_back(static_cast<char>(run + 126));
+            out.push_back(shuffled[pos]);
+            pos += run;
+            continue;
+        }
+        // Literals extend until the next pair of repeated bytes
+        int len = 1;
+        while ((pos + len < size) && (len < 128) &&
+               ((pos + len + 1 >= size) ||
+                (shuffled[pos + len] != shuffled[pos + len + 1]))) {
+            len++;
+        }
+        out.push_back(static_cast<char>(len - 1));
+        out.insert(out.end(), shuffled.begin() + pos, shuffled.begin() + pos + len);
+        pos += len;
+    }
+    return true;
+}
+
+void
+ShuffleRleCodec::decode(const char* data, int size, int valueSize,
+                        char* block, int blockSize) const {
+    std::vector<char> shuffled;
+    shuffled.reserve(blockSize);
+    for (const char* end = data + size; data < end; ) {
+        const int control = static_cast<unsigned char>(*data++);
+        if (control < 128) {
+            shuffled.insert(shuffled.end(), data, data + control + 1);
+            data += control + 1;
+        } else {
+            shuffled.insert(shuffled.end(), control - 126, *data++);
+        }
+    }
+    const int count = blockSize / valueSize;
+    for (int i = 0; i < count; i++) {
+        for (int b = 0; b < valueSize; b++) {
+            block[i * valueSize + b] = shuffled[b * count + i];
+        }
+    }
+    std::copy(shuffled.begin() + count * valueSize, shuffled.end(),
+              block + count * valueSize);
+}
+
+END_NAMESPACE(pc2l);
+
+#endif
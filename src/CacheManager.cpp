@@ -36,15 +36,26 @@
 // --------------------------------------------------------------------
 // Authors:   Dhananjai M. Rao          raodm@miamioh.edu
 //---------------------------------------------------------------------
+#include <sys/stat.h>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <numeric>
 #include <thread>
 #include "CacheManager.h"
 #include "Exception.h"
+#include "System.h"
 
 // namespace pc2l {
 BEGIN_NAMESPACE(pc2l);
 
 void
 CacheManager::finalize() {
+    // Wait for outstanding block requests, so that workers do not
+    // wait to finish sending them
+    waitForPendingBlocks();
+    // Blocks being streamed to workers must be delivered first
+    completeSends(true);
     const auto workers = MPI_GET_SIZE();
     auto finMsg = Message::create(0, Message::FINISH);
     // Send finish message to all of the worker-processes
@@ -55,6 +66,9 @@ CacheManager::finalize() {
 
 MessagePtr CacheManager::getBlock(size_t key) {
     MessagePtr ret = nullptr;
+    if (pending.find(key) != pending.end()) {
+        waitForBlock(key);
+    }
     if (cache.find(key) != cache.end()) {
         ret = cache[key];
         refer(cache[key]);
@@ -62,6 +76,655 @@ MessagePtr CacheManager::getBlock(size_t key) {
     return ret;
 }
 
+MessagePtr
+CacheManager::fetchBlock(unsigned int dsTag, size_t blockTag) {
+    const size_t key = getKey(dsTag, blockTag);
+    MessagePtr ret = getBlock(key);
+    if (ret == nullptr) {
+        requestBlock(dsTag, blockTag);
+        waitForBlock(key);
+        const auto entry = cache.find(key);
+        if (entry == cache.end()) {
+            throw PC2L_EXP("Block %zu of data structure %u not found",
+                           "Data structure is inconsistent", blockTag, dsTag);
+        }
+        ret = entry->second;
+    }
+    return ret;
+}
+
+void
+CacheManager::requestBlock(unsigned int dsTag, size_t blockTag) {
+    const size_t key = getKey(dsTag, blockTag);
+    if (cache.find(key) != cache.end() || pending.find(key) != pending.end()) {
+        return;
+    }
+    const int rank = getOwnerRank(blockTag);
+    MessagePtr msg = Message::create(0, Message::GET_BLOCK, 0);
+    msg->dsTag = dsTag;
+    msg->blockTag = blockTag;
+    send(msg, rank);
+    pending[key] = rank;
+}
+
+void
+CacheManager::streamBlock(const MessagePtr& msg) {
+    isend((msg->tag == Message::STORE_BLOCK) ? encodeBlock(msg) : msg,
+          getOwnerRank(msg->blockTag));
+    limitSends(std::max(1, storeDepth) * (MPI_GET_SIZE() - 1));
+}
+
+void
+CacheManager::setCodec(unsigned int dsTag, int codec, int valueSize) {
+    if (codec == BlockCodec::NONE) {
+        codecs.erase(dsTag);
+    } else {
+        System::get().getCodec(codec);  // Check that the codec exists
+        codecs[dsTag] = {codec, valueSize};
+    }
+}
+
+void
+CacheManager::setWritePolicy(unsigned int dsTag, WritePolicy policy) {
+    if (policy == WRITE_BACK) {
+        writePolicies.erase(dsTag);
+    } else {
+        writePolicies[dsTag] = policy;
+    }
+}
+
+MessagePtr
+CacheManager::encodeBlock(const MessagePtr& block) {
+    const auto entry = codecs.find(block->dsTag);
+    return (entry == codecs.end()) ? block :
+        BlockCodec::encodeBlock(block, entry->second.first, entry->second.second);
+}
+
+void
+CacheManager::markDirty(const MessagePtr& block, unsigned int offset,
+                        unsigned int len) {
+    const auto entry = writePolicies.find(block->dsTag);
+    const WritePolicy policy = (entry != writePolicies.end()) ? entry->second :
+        WRITE_BACK;
+    if (policy != WRITE_AROUND) {
+        storeCacheBlock(block);
+    }
+    addDirtyRange(getKey(block), offset, offset + len);
+    if (policy != WRITE_BACK) {
+        writeDirtyRanges(block);
+    }
+    // Writable blocks that are still held stay cached (and dirty)
+    if (policy == WRITE_AROUND && dirty.count(getKey(block)) == 0) {
+        dropCacheBlock(getKey(block));
+    }
+}
+
+void
+CacheManager::markWritable(const MessagePtr& block) {
+    storeCacheBlock(block);
+    addDirtyRange(getKey(block), 0, block->getPayloadSize());
+    writable.insert(getKey(block));
+}
+
+void
+CacheManager::addDirtyRange(size_t key, unsigned int first, unsigned int last) {
+    // Insert the range, merging it with the ranges it overlaps or touches
+    auto& ranges = dirty[key];
+    auto pos = std::lower_bound(ranges.begin(), ranges.end(),
+                                std::make_pair(first, 0u));
+    if (pos != ranges.begin() && std::prev(pos)->second >= first) {
+        --pos;
+    }
+    auto end = pos;
+    for (; (end != ranges.end()) && (end->first <= last); ++end) {
+        first = std::min(first, end->first);
+        last  = std::max(last, end->second);
+    }
+    pos = ranges.erase(pos, end);
+    ranges.insert(pos, std::make_pair(first, last));
+    if (ranges.size() > MaxDirtyRanges) {
+        ranges = {std::make_pair(ranges.front().first, ranges.back().second)};
+    }
+}
+
+void
+CacheManager::writeDirtyRanges(const MessagePtr& block) {
+    const auto entry = dirty.find(getKey(block));
+    if (entry == dirty.end()) {
+        return;
+    }
+    const auto& ranges = entry->second;
+    const unsigned int blockSize = block->getPayloadSize();
+    int patchSize = 0;
+    for (const auto& range : ranges) {
+        patchSize += 2 * sizeof(unsigned int) + range.second - range.first;
+    }
+    const int rank = getOwnerRank(block->blockTag);
+    if ((ranges.front().first == 0 && ranges.front().second == blockSize) ||
+        patchSize >= static_cast<int>(blockSize)) {
+        send(encodeBlock(block), rank);
+    } else {
+        MessagePtr msg = Message::create(patchSize, Message::PATCH_BLOCK, 0);
+        msg->dsTag    = block->dsTag;
+        msg->blockTag = block->blockTag;
+        char* patch = msg->getPayload();
+        for (const auto& range : ranges) {
+            const unsigned int info[2] = {range.first, range.second - range.first};
+            std::copy_n(reinterpret_cast<const char*>(info), sizeof(info), patch);
+            patch = std::copy(block->getPayload() + range.first,
+                              block->getPayload() + range.second,
+                              patch + sizeof(info));
+        }
+        send(msg, rank);
+    }
+    // A writable block that is still held outside of the cache (e.g.,
+    // by a Vector iterator) may be modified again without being
+    // marked, so it stays dirty until it is released.
+    const auto cached = cache.find(entry->first);
+    if (writable.count(entry->first) != 0 && cached != cache.end() &&
+        cached->second.use_count() > 1) {
+        entry->second = {std::make_pair(0u, blockSize)};
+    } else {
+        writable.erase(entry->first);
+        dirty.erase(entry);
+    }
+}
+
+void
+CacheManager::evictBlock(const MessagePtr& block) {
+    writeDirtyRanges(block);
+}
+
+void
+CacheManager::dropCacheBlock(size_t key) {
+    dirty.erase(key);
+    writable.erase(key);
+    CacheWorker::dropCacheBlock(key);
+}
+
+bool
+CacheManager::pollBlock(unsigned int dsTag, size_t blockTag) {
+    receiveArrivedBlocks();
+    return pending.find(getKey(dsTag, blockTag)) == pending.end();
+}
+
+void
+CacheManager::patchBlock(unsigned int dsTag, size_t blockTag, unsigned int offset,
+                         const char* data, unsigned int len) {
+    const size_t key = getKey(dsTag, blockTag);
+    // A block in flight would overwrite the patch when it arrives
+    waitForBlock(key);
+    MessagePtr block = getBlock(key);
+    if (block != nullptr) {
+        std::copy_n(data, len, block->getPayload() + offset);
+        markDirty(block, offset, len);
+        return;
+    }
+    const unsigned int range[2] = {offset, len};
+    MessagePtr msg = Message::create(sizeof(range) + len, Message::PATCH_BLOCK, 0);
+    msg->dsTag = dsTag;
+    msg->blockTag = blockTag;
+    std::copy_n(reinterpret_cast<const char*>(range), sizeof(range),
+                msg->getPayload());
+    std::copy_n(data, len, msg->getPayload() + sizeof(range));
+    streamBlock(msg);
+}
+
+void
+CacheManager::gatherValues(unsigned int dsTag,
+                           const std::vector<std::pair<size_t, size_t>>& locations,
+                           int valueSize, char* out) {
+    // The positions (in locations) of the values requested from each worker
+    const int workers = MPI_GET_SIZE() - 1;
+    std::vector<std::vector<size_t>> buckets(workers);
+    for (size_t i = 0; i < locations.size(); i++) {
+        const auto entry = cache.find(getKey(dsTag, locations[i].first));
+        if (entry != cache.end()) {
+            std::copy_n(entry->second->getPayload() + locations[i].second,
+                        valueSize, out + i * valueSize);
+        } else {
+            buckets[getOwnerRank(locations[i].first) - 1].push_back(i);
+        }
+    }
+    for (int rank = 1; (rank <= workers); rank++) {
+        const std::vector<size_t>& bucket = buckets[rank - 1];
+        if (!bucket.empty()) {
+            isend(makeGatherRequest(dsTag, Message::GATHER, locations, bucket,
+                                    valueSize, nullptr), rank);
+        }
+    }
+    for (int rank = 1; (rank <= workers); rank++) {
+        const std::vector<size_t>& bucket = buckets[rank - 1];
+        if (bucket.empty()) {
+            continue;
+        }
+        // Blocks being prefetched may arrive ahead of the reply
+        MessagePtr reply = recv(rank, true, Message::GATHER);
+        for (size_t i = 0; i < bucket.size(); i++) {
+            std::copy_n(reply->getPayload() + i * valueSize, valueSize,
+                        out + bucket[i] * valueSize);
+        }
+    }
+    completeSends();
+}
+
+void
+CacheManager::scatterValues(unsigned int dsTag,
+                            const std::vector<std::pair<size_t, size_t>>& locations,
+                            int valueSize, const char* values) {
+    const int workers = MPI_GET_SIZE() - 1;
+    std::vector<std::vector<size_t>> buckets(workers);
+    for (size_t i = 0; i < locations.size(); i++) {
+        const size_t key = getKey(dsTag, locations[i].first);
+        // A block in flight would overwrite the value when it arrives
+        waitForBlock(key);
+        const auto entry = cache.find(key);
+        if (entry != cache.end()) {
+            std::copy_n(values + i * valueSize, valueSize,
+                        entry->second->getPayload() + locations[i].second);
+            markDirty(entry->second, locations[i].second, valueSize);
+        } else {
+            buckets[getOwnerRank(locations[i].first) - 1].push_back(i);
+        }
+    }
+    for (int rank = 1; (rank <= workers); rank++) {
+        const std::vector<size_t>& bucket = buckets[rank - 1];
+        if (!bucket.empty()) {
+            streamBlock(makeGatherRequest(dsTag, Message::SCATTER, locations,
+                                          bucket, valueSize, values));
+        }
+    }
+}
+
+MessagePtr
+CacheManager::makeGatherRequest(unsigned int dsTag, Message::MsgTag tag,
+                                const std::vector<std::pair<size_t, size_t>>& locations,
+                                const std::vector<size_t>& bucket, int valueSize,
+                                const char* values) {
+    const GatherInfo info = {bucket.size(), static_cast<unsigned long long>(valueSize)};
+    const size_t recordSize = 2 * sizeof(unsigned long long);
+    const size_t valuesSize = (values != nullptr) ? bucket.size() * valueSize : 0;
+    MessagePtr msg = Message::create(sizeof(info) + bucket.size() * recordSize +
+                                     valuesSize, tag, 0);
+    msg->dsTag = dsTag;
+    // streamBlock() sends the message to the owner of this block
+    msg->blockTag = locations[bucket.front()].first;
+    char* payload = msg->getPayload();
+    std::copy_n(reinterpret_cast<const char*>(&info), sizeof(info), payload);
+    char* records = payload + sizeof(info);
+    char* dest    = records + bucket.size() * recordSize;
+    for (size_t i = 0; i < bucket.size(); i++) {
+        const std::pair<size_t, size_t>& location = locations[bucket[i]];
+        const unsigned long long record[2] = {location.first, location.second};
+        std::copy_n(reinterpret_cast<const char*>(record), recordSize,
+                    records + i * recordSize);
+        if (values != nullptr) {
+            std::copy_n(values + bucket[i] * valueSize, valueSize,
+                        dest + i * valueSize);
+        }
+    }
+    return msg;
+}
+
+void
+CacheManager::fillBlocks(unsigned int dsTag, size_t firstBlock, size_t lastBlock,
+                         size_t blockSize, const char* value, int valueSize) {
+    waitForPendingBlocks();
+    dropCacheBlocks(dsTag, firstBlock, lastBlock);
+    const FillInfo info = {lastBlock, blockSize};
+    MessagePtr msg = Message::create(sizeof(info) + valueSize,
+                                     Message::FILL_BLOCK, 0);
+    msg->dsTag    = dsTag;
+    msg->blockTag = firstBlock;
+    std::copy_n(reinterpret_cast<const char*>(&info), sizeof(info),
+                msg->getPayload());
+    std::copy_n(value, valueSize, msg->getPayload() + sizeof(info));
+    const auto workers = MPI_GET_SIZE();
+    for (int rank = 1; (rank < workers); rank++) {
+        send(msg, rank);
+    }
+}
+
+void
+CacheManager::dropDataStructure(unsigned int dsTag) {
+    waitForPendingBlocks();
+    MessagePtr msg = Message::create(0, Message::DROP_DS, 0);
+    msg->dsTag = dsTag;
+    CacheWorker::dropDataStructure(msg);
+    patterns.erase(dsTag);
+    const auto workers = MPI_GET_SIZE();
+    for (int rank = 1; (rank < workers); rank++) {
+        send(msg, rank);
+    }
+}
+
+void
+CacheManager::cloneDataStructure(unsigned int srcDs, unsigned int destDs) {
+    waitForPendingBlocks();
+    writeBack(srcDs, false);
+    // The copies of encoded blocks are encoded as well
+    const auto codec = codecs.find(srcDs);
+    if (codec != codecs.end()) {
+        codecs[destDs] = codec->second;
+    } else {
+        codecs.erase(destDs);
+    }
+    const auto policy = writePolicies.find(srcDs);
+    setWritePolicy(destDs, (policy != writePolicies.end()) ? policy->second :
+                   WRITE_BACK);
+    MessagePtr msg = Message::create(sizeof(destDs), Message::CLONE_DS, 0);
+    msg->dsTag = srcDs;
+    std::copy_n(reinterpret_cast<const char*>(&destDs), sizeof(destDs),
+                msg->getPayload());
+    const auto workers = MPI_GET_SIZE();
+    for (int rank = 1; (rank < workers); rank++) {
+        send(msg, rank);
+    }
+}
+
+void
+CacheManager::saveDataStructure(unsigned int dsTag, const std::string& dir,
+                                size_t blockCount, const std::string& info) {
+    waitForPendingBlocks();
+    writeBack(dsTag, false);
+    const unsigned long long count = blockCount;
+    MessagePtr msg = Message::create(sizeof(count) + dir.size(),
+                                     Message::SAVE_DS, 0);
+    msg->dsTag = dsTag;
+    std::copy_n(reinterpret_cast<const char*>(&count), sizeof(count),
+                msg->getPayload());
+    std::copy(dir.begin(), dir.end(), msg->getPayload() + sizeof(count));
+    requestFileOperation(msg);
+    // Blocks are assigned to workers round-robin, so they can only be
+    // opened with the same number of workers
+    const int workers = MPI_GET_SIZE() - 1;
+    ::mkdir(dir.c_str(), 0755);
+    std::ofstream file(dir + "/info.pc2l", std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&workers), sizeof(workers));
+    file.write(info.data(), info.size());
+    file.close();
+    if (!file) {
+        throw PC2L_EXP("Error writing %s/info.pc2l", "Check the directory",
+                       dir.c_str());
+    }
+}
+
+std::string
+CacheManager::openDataStructure(unsigned int dsTag, const std::string& dir) {
+    std::ifstream file(dir + "/info.pc2l", std::ios::binary);
+    int workers = 0;
+    file.read(reinterpret_cast<char*>(&workers), sizeof(workers));
+    if (!file) {
+        throw PC2L_EXP("Unable to read %s/info.pc2l", "Check the directory",
+                       dir.c_str());
+    }
+    if (workers != MPI_GET_SIZE() - 1) {
+        throw PC2L_EXP("%s was saved with %d workers, not %d",
+                       "Run with the same number of processes", dir.c_str(),
+                       workers, MPI_GET_SIZE() - 1);
+    }
+    const std::string info((std::istreambuf_iterator<char>(file)),
+                           std::istreambuf_iterator<char>());
+    MessagePtr msg = Message::create(dir.size(), Message::OPEN_DS, 0);
+    msg->dsTag = dsTag;
+    std::copy(dir.begin(), dir.end(), msg->getPayload());
+    requestFileOperation(msg);
+    return info;
+}
+
+void
+CacheManager::requestFileOperation(const MessagePtr& msg) {
+    const auto workers = MPI_GET_SIZE();
+    for (int rank = 1; (rank < workers); rank++) {
+        send(msg, rank);
+    }
+    // Wait for all the workers, even if some of them fail
+    std::string error;
+    for (int rank = 1; (rank < workers); rank++) {
+        MessagePtr reply = recv(rank, true, msg->tag);
+        if (error.empty()) {
+            error.assign(reply->getPayload(), reply->getPayloadSize());
+        }
+    }
+    if (!error.empty()) {
+        throw PC2L_EXP("%s", "Check the directory on all the workers",
+                       error.c_str());
+    }
+}
+
+bool
+CacheManager::compute(unsigned int dsTag, int kernelId, unsigned long long count,
+                      unsigned long long perBlock, char* result) {
+    Kernel& kernel = System::get().getKernel(kernelId);
+    waitForPendingBlocks();
+    writeBack(dsTag, kernel.modifiesValues());
+    const ComputeInfo info = {kernelId, count, perBlock};
+    MessagePtr msg = Message::create(sizeof(info), Message::COMPUTE, 0);
+    msg->dsTag = dsTag;
+    std::copy_n(reinterpret_cast<const char*>(&info), sizeof(info),
+                msg->getPayload());
+    const auto workers = MPI_GET_SIZE();
+    for (int rank = 1; (rank < workers); rank++) {
+        send(msg, rank);
+    }
+    // Combine the partial results from the workers
+    bool hasResult = false;
+    for (int rank = 1; (rank < workers); rank++) {
+        MessagePtr reply = recv(rank, true, Message::COMPUTE);
+        if (reply->getPayload()[0] == 0) {
+            continue;
+        } else if (hasResult) {
+            kernel.combine(result, reply->getPayload() + 1);
+        } else {
+            std::copy_n(reply->getPayload() + 1, kernel.resultSize(), result);
+            hasResult = true;
+        }
+    }
+    return hasResult;
+}
+
+unsigned long long
+CacheManager::search(unsigned int dsTag, int kernelId, unsigned long long count,
+                     unsigned long long perBlock, const char* value,
+                     int valueSize, bool findFirst) {
+    waitForPendingBlocks();
+    writeBack(dsTag, false);
+    const int dataSize = (kernelId < 0) ? valueSize : 0;
+    const SearchInfo info = {kernelId, findFirst, count, perBlock,
+                             static_cast<unsigned long long>(valueSize)};
+    MessagePtr msg = Message::create(sizeof(info) + dataSize, Message::SEARCH, 0);
+    msg->dsTag = dsTag;
+    std::copy_n(reinterpret_cast<const char*>(&info), sizeof(info),
+                msg->getPayload());
+    std::copy_n(value, dataSize, msg->getPayload() + sizeof(info));
+    const auto workers = MPI_GET_SIZE();
+    for (int rank = 1; (rank < workers); rank++) {
+        send(msg, rank);
+    }
+    // Combine the partial results from the workers
+    unsigned long long result = findFirst ? count : 0;
+    for (int rank = 1; (rank < workers); rank++) {
+        MessagePtr reply = recv(rank, true, Message::SEARCH);
+        unsigned long long partial;
+        std::copy_n(reply->getPayload(), sizeof(partial),
+                    reinterpret_cast<char*>(&partial));
+        result = findFirst ? std::min(result, partial) : result + partial;
+    }
+    return result;
+}
+
+void
+CacheManager::sort(unsigned int dsTag, int kernelId, unsigned long long count,
+                   unsigned long long perBlock) {
+    const Kernel& kernel = System::get().getKernel(kernelId);
+    const int valueSize  = kernel.valueSize();
+    const int workers    = MPI_GET_SIZE() - 1;
+    waitForPendingBlocks();
+    writeBack(dsTag, true);
+    // Collect samples from the workers
+    SortInfo info = {SortInfo::SAMPLE, kernelId, count, perBlock};
+    sendSortStep(dsTag, info, nullptr, 0);
+    std::vector<char> samples;
+    for (int rank = 1; (rank <= workers); rank++) {
+        MessagePtr reply = recv(rank, true, Message::SORT);
+        samples.insert(samples.end(), reply->getPayload(),
+                       reply->getPayload() + reply->getPayloadSize());
+    }
+    // Pick evenly spaced splitters from the sorted samples
+    const long long sampleCount = samples.size() / valueSize;
+    kernel.sort(samples.data(), sampleCount);
+    std::vector<char> splitters((workers - 1) * valueSize);
+    for (int b = 1; (b < workers) && (sampleCount > 0); b++) {
+        std::copy_n(samples.data() + (b * sampleCount / workers) * valueSize,
+                    valueSize, splitters.data() + (b - 1) * valueSize);
+    }
+    info.step = SortInfo::PARTITION;
+    sendSortStep(dsTag, info, splitters.data(), splitters.size());
+    // Compute where each bucket starts from the size of its parts
+    std::vector<unsigned long long> starts(workers + 1);
+    for (int rank = 1; (rank <= workers); rank++) {
+        MessagePtr reply = recv(rank, true, Message::SORT);
+        const unsigned long long* counts =
+            reinterpret_cast<const unsigned long long*>(reply->getPayload());
+        for (int b = 0; (b < workers); b++) {
+            starts[b + 1] += counts[b];
+        }
+    }
+    std::partial_sum(starts.begin(), starts.end(), starts.begin());
+    info.step = SortInfo::EXCHANGE;
+    sendSortStep(dsTag, info, reinterpret_cast<const char*>(starts.data()),
+                 starts.size() * sizeof(starts[0]));
+    // Wait for the workers to finish writing the sorted blocks
+    for (int rank = 1; (rank <= workers); rank++) {
+        recv(rank, true, Message::SORT);
+    }
+}
+
+unsigned long long
+CacheManager::bitwise(unsigned int dsTag, BitOp op, unsigned int srcDs,
+                      size_t blockCount, size_t blockSize) {
+    waitForPendingBlocks();
+    writeBack(dsTag, op != BIT_COUNT);
+    if (srcDs != dsTag) {
+        writeBack(srcDs, false);
+    }
+    const BitwiseInfo info = {op, srcDs, blockCount, blockSize};
+    MessagePtr msg = Message::create(sizeof(info), Message::BITWISE, 0);
+    msg->dsTag = dsTag;
+    std::copy_n(reinterpret_cast<const char*>(&info), sizeof(info),
+                msg->getPayload());
+    const auto workers = MPI_GET_SIZE();
+    for (int rank = 1; (rank < workers); rank++) {
+        send(msg, rank);
+    }
+    // Add up the partial counts from the workers
+    unsigned long long bits = 0;
+    for (int rank = 1; (rank < workers); rank++) {
+        MessagePtr reply = recv(rank, true, Message::BITWISE);
+        unsigned long long partial;
+        std::copy_n(reply->getPayload(), sizeof(partial),
+                    reinterpret_cast<char*>(&partial));
+        bits += partial;
+    }
+    return bits;
+}
+
+void
+CacheManager::sendSortStep(unsigned int dsTag, const SortInfo& info,
+                           const char* data, int dataSize) {
+    MessagePtr msg = Message::create(sizeof(info) + dataSize, Message::SORT, 0);
+    msg->dsTag = dsTag;
+    std::copy_n(reinterpret_cast<const char*>(&info), sizeof(info),
+                msg->getPayload());
+    std::copy_n(data, dataSize, msg->getPayload() + sizeof(info));
+    const auto workers = MPI_GET_SIZE();
+    for (int rank = 1; (rank < workers); rank++) {
+        send(msg, rank);
+    }
+}
+
+void
+CacheManager::writeBack(unsigned int dsTag, bool drop) {
+    std::vector<size_t> keys;
+    for (const auto& entry : cache) {
+        const MessagePtr& block = entry.second;
+        if (block->dsTag == dsTag) {
+            writeDirtyRanges(block);
+            keys.push_back(entry.first);
+        }
+    }
+    for (size_t i = 0; drop && (i < keys.size()); i++) {
+        dropCacheBlock(keys[i]);
+    }
+}
+
+void
+CacheManager::waitForBlock(size_t key) {
+    // Replies from a worker arrive in the order they were requested,
+    // so blocks requested earlier may arrive first.
+    for (auto entry = pending.find(key); entry != pending.end();
+         entry = pending.find(key)) {
+        receiveBlock(recv(entry->second));
+    }
+}
+
+void
+CacheManager::waitForPendingBlocks() {
+    while (!pending.empty()) {
+        waitForBlock(pending.begin()->first);
+    }
+}
+
+void
+CacheManager::receiveArrivedBlocks() {
+    while (!pending.empty()) {
+        MessagePtr msg = recv(MPI_ANY_SOURCE, false);
+        if (msg == nullptr) {
+            break;
+        }
+        receiveBlock(msg);
+    }
+}
+
+void
+CacheManager::receiveBlock(const MessagePtr& msg) {
+    const size_t key = getKey(msg);
+    pending.erase(key);
+    if (msg->tag == Message::ENCODED_BLOCK && cache.find(key) == cache.end()) {
+        storeCacheBlock(BlockCodec::decodeBlock(msg));
+    } else if (msg->tag != Message::BLOCK_NOT_FOUND && cache.find(key) == cache.end()) {
+        storeCacheBlock(msg);
+    }
+}
+
+void
+CacheManager::recordAccess(unsigned int dsTag, size_t blockTag, size_t blockCount,
+                           size_t blockSize) {
+    // Put blocks that were prefetched earlier into the cache
+    receiveArrivedBlocks();
+    AccessPattern& pattern = patterns[dsTag];
+    const long long block = blockTag;
+    if (block == pattern.lastBlock) {
+        // Repeated accesses to the same block do not change the pattern
+        return;
+    }
+    const long long stride = block - pattern.lastBlock;
+    pattern.repeats   = (stride == pattern.stride) ? pattern.repeats + 1 : 0;
+    pattern.stride    = stride;
+    pattern.lastBlock = block;
+    if (pattern.repeats == 0) {
+        return;
+    }
+    // Leave room in the cache for the block being accessed
+    const long long depth = std::min<long long>(
+        prefetchDepth, cacheSize / (blockSize + sizeof(Message)) - 1);
+    for (long long i = 1, next = block + stride;
+         (i <= depth) && (next >= 0) && (next < (long long) blockCount);
+         i++, next += stride) {
+        requestBlock(dsTag, next);
+    }
+}
+
 
 void CacheManager::run() {
     // bgWorker = std::thread(CacheManager::runBackgroundWorker);
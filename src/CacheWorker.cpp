@@ -37,24 +37,54 @@
 // Authors:   Dhananjai M. Rao          raodm@miamioh.edu
 //---------------------------------------------------------------------
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include "CacheWorker.h"
 #include "Exception.h"
+#include "System.h"
 
 // namespace pc2l {
 BEGIN_NAMESPACE(pc2l);
 
-CacheWorker::CacheWorker() {
+CacheWorker::CacheWorker() : eviction(new RecencyPolicy(false)) {
     // Do not perform MPI-related operation in the constructor.
     // Instead do them in the initialize method.
-    blockNotFoundMsg = Message::create(0, Message::BLOCK_NOT_FOUND);
+}
+
+void
+CacheWorker::setEvictionStrategy(EvictionStrategy strategy) {
+    switch (strategy) {
+    case LRU:   eviction.reset(new RecencyPolicy(false)); break;
+    case MRU:   eviction.reset(new RecencyPolicy(true));  break;
+    case LFU:   eviction.reset(new LfuPolicy());         break;
+    case CLOCK: eviction.reset(new ClockPolicy());       break;
+    case ARC:   eviction.reset(new ArcPolicy());         break;
+    default:
+        throw PC2L_EXP("Invalid eviction strategy %d",
+                       "Use one of CacheWorker::EvictionStrategy", strategy);
+    }
+    evictionStrategy = strategy;
+    for (const auto& entry : cache) {
+        eviction->insert(entry.first);
+    }
 }
 
 void
 CacheWorker::run() {
     // Keep processing messages until we get a message with finish tag.
     for (MessagePtr msg = recv(); msg->tag != Message::FINISH; msg = recv()) {
+        // Release blocks whose replies have been sent
+        completeSends();
         switch (msg->tag) {
         case Message::STORE_BLOCK:
+        case Message::ENCODED_BLOCK:
             storeCacheBlock(msg);
             break;
         case Message::GET_BLOCK:
@@ -63,46 +93,106 @@ CacheWorker::run() {
         case Message::ERASE_BLOCK:
             eraseCacheBlock(msg);
             break;
+        case Message::SHIFT:
+            shiftCacheBlock(msg);
+            break;
+        case Message::PATCH_BLOCK:
+            patchCacheBlock(msg);
+            break;
+        case Message::GATHER:
+            gatherValues(msg);
+            break;
+        case Message::SCATTER:
+            scatterValues(msg);
+            break;
+        case Message::FILL_BLOCK:
+            fillCacheBlocks(msg);
+            break;
+        case Message::DROP_DS:
+            dropDataStructure(msg);
+            break;
+        case Message::COMPUTE:
+            computeBlocks(msg);
+            break;
+        case Message::SORT:
+            sortBlocks(msg);
+            break;
+        case Message::BITWISE:
+            bitwiseBlocks(msg);
+            break;
+        case Message::CLONE_DS:
+            cloneDataStructure(msg);
+            break;
+        case Message::SEARCH:
+            searchBlocks(msg);
+            break;
+        case Message::SAVE_DS:
+            saveDataStructure(msg);
+            break;
+        case Message::OPEN_DS:
+            openDataStructure(msg);
+            break;
         default:
             throw PC2L_EXP("Received unhandled message. Tag=%d",
                            "Need to implement?", msg->tag);
         }
     }
+    completeSends(true);
 }
 
 void CacheWorker::refer(const MessagePtr& msg) {
     const auto key = getKey(msg);
-    if (cache.find(key) == cache.end()) {
-        // Use eviction strategy if cache is overfull
-        if (msg->getPayloadSize() * cache.size() >= cacheSize) {
-            auto last = lruBlock.back();
-            lruBlock.pop_back();
-            placeInQ.erase(last);
-            // send evicted block to remote cacheworker
-            MessagePtr evicted = cache[last];
-            cache.erase(last);
-            const int destRank = (evicted->blockTag % (System::get().worldSize() - 1)) + 1;
-            send(evicted, destRank);
-        }
-    }else {
-        // If the block is present in the cache, we need to update its place in the queue
-        lruBlock.erase(placeInQ[key]);
+    if (cache.find(key) != cache.end()) {
+        eviction->access(key);
+        return;
     }
-    // Update the reference in the order queue
-    lruBlock.push_front(key);
-    placeInQ[key] = lruBlock.begin();
+    // Use eviction strategy until the new block fits. Blocks that are
+    // still referenced outside of the cache (e.g., by a Vector
+    // iterator) are pinned and are not evicted, so the cache may
+    // exceed its size when all blocks are pinned.
+    const auto evictable = [this](size_t candidate) {
+        return cache.at(candidate).use_count() == 1;
+    };
+    size_t victim;
+    while (cachedBytes + msg->getSize() > cacheSize &&
+           eviction->evict(key, evictable, victim)) {
+        // write the evicted block back (see evictBlock())
+        MessagePtr evicted = cache.at(victim);
+        cache.erase(victim);
+        cachedBytes -= evicted->getSize();
+        evictBlock(evicted);
+    }
+    eviction->insert(key);
+}
+
+void
+CacheWorker::evictBlock(const MessagePtr& block) {
+    send(block, getOwnerRank(block->blockTag));
+}
+
+int
+CacheWorker::getOwnerRank(size_t blockTag) {
+    return (blockTag % (System::get().worldSize() - 1)) + 1;
 }
 
 void
 CacheWorker::storeCacheBlock(const MessagePtr& msg) {
-    // Clone this message for storing into our cache
-    MessagePtr clone = Message::create(*msg);
+    // Messages that are just a view of the receive buffer must be
+    // cloned for storing into our cache. Messages that own their
+    // buffer can be stored as-is, avoiding a copy of the whole block.
+    MessagePtr clone = msg->ownBuf ? msg : Message::create(*msg);
     // Get the aggregate key for this block.
     const auto key   = getKey(clone);
     // Refer to our eviction structure
     refer(msg);
-    // Put a clone of the message in the cache
-    cache[key] = clone;
+    // Put a clone of the message in the cache, replacing the old
+    // version of the block (if any)
+    MessagePtr& entry = cache[key];
+    if (entry != nullptr) {
+        cachedBytes -= entry->getSize();
+    }
+    entry = clone;
+    cachedBytes += clone->getSize();
 }
 
 void
@@ -111,18 +201,24 @@ CacheWorker::sendCacheBlock(const MessagePtr& msg) {
     const auto key = getKey(msg);
     // Get entry for key, if present in the cache
     const auto entry = cache.find(key);
-    // If the entry is found, send it back to the requestor
+    // If the entry is found, send it back to the requestor.  The
+    // send is non-blocking so that this worker never waits on a
+    // requestor that has several requests outstanding.
     if (entry != cache.end()) {
         refer(entry->second);
-        send(entry->second, msg->srcRank);
+        isend(entry->second, msg->srcRank);
+    } else if (MessagePtr block = materializeBlock(msg->dsTag, msg->blockTag)) {
+        // The block was filled lazily and has just been created
+        isend(block, msg->srcRank);
+    } else {
+        // When control drops here, that means the requested block was
+        // not found in cache.  In this situation, we send a
+        // block-not-found message back.
+        MessagePtr notFound = Message::create(0, Message::BLOCK_NOT_FOUND);
+        notFound->dsTag     = msg->dsTag;
+        notFound->blockTag  = msg->blockTag;
+        isend(notFound, msg->srcRank);
     }
-    //     // When control drops here, that means the requested block was
-    //     // not found in cache.  In this situation, we send a
-    //     // block-not-found message back.
-    //     blockNotFoundMsg->dsTag    = msg->dsTag;
-    //     blockNotFoundMsg->blockTag = msg->blockTag;
-    //     send(blockNotFoundMsg, msg->srcRank);
-    // }
 }
 void
 CacheWorker::eraseCacheBlock(const MessagePtr& msg) {
@@ -132,7 +228,7 @@ CacheWorker::eraseCacheBlock(const MessagePtr& msg) {
     const auto entry = cache.find(key);
     // If the entry is found, delete the entry
     if (entry != cache.end()) {
-        cache.erase(entry);
+        dropCacheBlock(key);
     }
     //     // When control drops here, that means the requested block was
     //     // not found in cache.  In this situation, we send a
@@ -143,6 +239,709 @@ CacheWorker::eraseCacheBlock(const MessagePtr& msg) {
     // }
 }
 
+void
+CacheWorker::shiftCacheBlock(const MessagePtr& msg) {
+    const auto entry = findCacheBlock(msg->dsTag, msg->blockTag);
+    if (entry == cache.end()) {
+        // An empty reply indicates that the block was not found
+        MessagePtr notFound = Message::create(0, Message::SHIFT, MPI_GET_RANK());
+        notFound->dsTag     = msg->dsTag;
+        notFound->blockTag  = msg->blockTag;
+        isend(notFound, msg->srcRank);
+        return;
+    }
+    // Extract the offset & direction followed by the carry-in bytes
+    const int* info    = reinterpret_cast<const int*>(msg->getPayload());
+    const int carryLen = msg->getPayloadSize() - 2 * sizeof(int);
+    // The reply carries the bytes shifted out of the block
+    MessagePtr reply = Message::create(carryLen, Message::SHIFT, MPI_GET_RANK());
+    reply->dsTag     = msg->dsTag;
+    reply->blockTag  = msg->blockTag;
+    MessagePtr& block = writableBlock(entry->second);
+    shiftBlock(block->getPayload(), block->getPayloadSize(), info[0], info[1],
+               msg->getPayload() + 2 * sizeof(int), carryLen,
+               reply->getPayload());
+    isend(reply, msg->srcRank);
+}
+
+void
+CacheWorker::fillCacheBlocks(const MessagePtr& msg) {
+    FillInfo info;
+    std::copy_n(msg->getPayload(), sizeof(info), reinterpret_cast<char*>(&info));
+    // Cached copies of the blocks are stale now
+    dropCacheBlocks(msg->dsTag, msg->blockTag, info.lastBlock);
+    // So are earlier fills within the range, which are never used again
+    auto& dsFills = fills[msg->dsTag];
+    const auto covered = [&msg, &info](const MessagePtr& fill) {
+        FillInfo fillInfo;
+        std::copy_n(fill->getPayload(), sizeof(fillInfo),
+                    reinterpret_cast<char*>(&fillInfo));
+        return fill->blockTag >= msg->blockTag &&
+            fillInfo.lastBlock <= info.lastBlock;
+    };
+    dsFills.erase(std::remove_if(dsFills.begin(), dsFills.end(), covered),
+                  dsFills.end());
+    dsFills.push_back(msg->ownBuf ? msg : Message::create(*msg));
+}
+
+void
+CacheWorker::dropDataStructure(const MessagePtr& msg) {
+    dropCacheBlocks(msg->dsTag, 0, -1U);
+    fills.erase(msg->dsTag);
+    mapped.erase(msg->dsTag);
+}
+
+void
+CacheWorker::cloneDataStructure(const MessagePtr& msg) {
+    unsigned int destDs;
+    std::copy_n(msg->getPayload(), sizeof(destDs), reinterpret_cast<char*>(&destDs));
+    std::vector<MessagePtr> blocks;
+    for (const auto& entry : cache) {
+        if (entry.second->dsTag == msg->dsTag) {
+            blocks.push_back(entry.second);
+        }
+    }
+    for (const MessagePtr& block : blocks) {
+        MessagePtr copy = Message::create(*block);
+        copy->dsTag = destDs;
+        storeCacheBlock(copy);
+    }
+    // Fill messages and mapped files are never modified, so they
+    // can be shared
+    const auto entry = fills.find(msg->dsTag);
+    if (entry != fills.end()) {
+        fills[destDs] = entry->second;
+    }
+    const auto file = mapped.find(msg->dsTag);
+    if (file != mapped.end()) {
+        mapped[destDs] = file->second;
+    }
+}
+
+void
+CacheWorker::computeBlocks(const MessagePtr& msg) {
+    ComputeInfo info;
+    std::copy_n(msg->getPayload(), sizeof(info), reinterpret_cast<char*>(&info));
+    Kernel& kernel = System::get().getKernel(info.kernel);
+    std::vector<char> result(kernel.resultSize());
+    bool hasResult = false;
+    // Blocks are assigned to workers round-robin (see getOwnerRank())
+    const size_t blockCount = (info.count + info.perBlock - 1) / info.perBlock;
+    const size_t workers    = System::get().worldSize() - 1;
+    for (size_t blockTag = MPI_GET_RANK() - 1; blockTag < blockCount;
+         blockTag += workers) {
+        // Blocks that are only read stay encoded in the cache
+        MessagePtr block;
+        if (kernel.modifiesValues()) {
+            const auto entry = findCacheBlock(msg->dsTag, blockTag);
+            if (entry != cache.end()) {
+                block = writableBlock(entry->second);
+            }
+        } else {
+            block = readCacheBlock(msg->dsTag, blockTag);
+        }
+        if (block == nullptr) {
+            continue;
+        }
+        char* values = block->getPayload();
+        const unsigned long long first = blockTag * info.perBlock;
+        kernel.apply(values, std::min(info.perBlock, info.count - first),
+                     result.data(), hasResult);
+    }
+    MessagePtr reply = Message::create(1 + result.size(), Message::COMPUTE,
+                                       MPI_GET_RANK());
+    reply->dsTag = msg->dsTag;
+    reply->getPayload()[0] = hasResult;
+    std::copy(result.begin(), result.end(), reply->getPayload() + 1);
+    isend(reply, msg->srcRank);
+}
+
+void
+CacheWorker::sortBlocks(const MessagePtr& msg) {
+    SortInfo info;
+    std::copy_n(msg->getPayload(), sizeof(info), reinterpret_cast<char*>(&info));
+    const char* data    = msg->getPayload() + sizeof(info);
+    const size_t dataSize = msg->getPayloadSize() - sizeof(info);
+    const Kernel& kernel  = System::get().getKernel(info.kernel);
+    const int valueSize   = kernel.valueSize();
+    const int rank        = MPI_GET_RANK();
+    const int workers     = System::get().worldSize() - 1;
+    SortState& state      = sorts[msg->dsTag];
+    switch (info.step) {
+    case SortInfo::SAMPLE: {
+        state = SortState();
+        state.info    = info;
+        state.manager = msg->srcRank;
+        // Gather the values in the blocks owned by this worker
+        const size_t blockCount = (info.count + info.perBlock - 1) / info.perBlock;
+        for (size_t blockTag = rank - 1; blockTag < blockCount; blockTag += workers) {
+            const MessagePtr block = readCacheBlock(msg->dsTag, blockTag);
+            if (block == nullptr) {
+                continue;
+            }
+            const char* values = block->getPayload();
+            const unsigned long long first = blockTag * info.perBlock;
+            const unsigned long long count = std::min(info.perBlock, info.count - first);
+            state.values.insert(state.values.end(), values, values + count * valueSize);
+        }
+        const long long count = state.values.size() / valueSize;
+        kernel.sort(state.values.data(), count);
+        // Reply with evenly spaced samples, 4 per bucket
+        const long long samples = std::min<long long>(count, 4 * workers);
+        MessagePtr reply = Message::create(samples * valueSize, Message::SORT, rank);
+        reply->dsTag = msg->dsTag;
+        for (long long i = 0; i < samples; i++) {
+            const long long index = (2 * i + 1) * count / (2 * samples);
+            std::copy_n(state.values.data() + index * valueSize, valueSize,
+                        reply->getPayload() + i * valueSize);
+        }
+        isend(reply, state.manager);
+        break;
+    }
+    case SortInfo::PARTITION: {
+        // Bucket b holds the values in [splitter b - 1, splitter b)
+        const unsigned long long count = state.values.size() / valueSize;
+        std::vector<unsigned long long> counts(workers);
+        state.bounds.assign(workers, count);
+        for (int b = 0; b < workers - 1; b++) {
+            const char* splitter = data + b * valueSize;
+            unsigned long long low = (b == 0) ? 0 : state.bounds[b - 1], high = count;
+            while (low < high) {
+                const unsigned long long mid = (low + high) / 2;
+                if (kernel.less(state.values.data() + mid * valueSize, splitter)) {
+                    low = mid + 1;
+                } else {
+                    high = mid;
+                }
+            }
+            state.bounds[b] = low;
+        }
+        for (int b = 0; b < workers; b++) {
+            counts[b] = state.bounds[b] - ((b == 0) ? 0 : state.bounds[b - 1]);
+        }
+        MessagePtr reply = Message::create(workers * sizeof(counts[0]),
+                                           Message::SORT, rank);
+        reply->dsTag = msg->dsTag;
+        std::copy_n(reinterpret_cast<const char*>(counts.data()),
+                    workers * sizeof(counts[0]), reply->getPayload());
+        isend(reply, state.manager);
+        break;
+    }
+    case SortInfo::EXCHANGE: {
+        const unsigned long long* starts =
+            reinterpret_cast<const unsigned long long*>(data);
+        state.starts.assign(starts, starts + workers + 1);
+        // Send each bucket (even if empty) to the worker sorting it
+        SortInfo partInfo = state.info;
+        partInfo.step     = SortInfo::DATA;
+        for (int b = 0; b < workers; b++) {
+            const unsigned long long first = (b == 0) ? 0 : state.bounds[b - 1];
+            const unsigned long long len   = (state.bounds[b] - first) * valueSize;
+            MessagePtr part = Message::create(sizeof(partInfo) + len,
+                                              Message::SORT, rank);
+            part->dsTag = msg->dsTag;
+            std::copy_n(reinterpret_cast<const char*>(&partInfo), sizeof(partInfo),
+                        part->getPayload());
+            std::copy_n(state.values.data() + first * valueSize, len,
+                        part->getPayload() + sizeof(partInfo));
+            isend(part, b + 1);
+        }
+        std::vector<char>().swap(state.values);
+        // Each bucket overlapping blocks owned by this worker sends
+        // one WRITE step to this worker
+        for (int b = 0; b < workers; b++) {
+            if (state.starts[b] == state.starts[b + 1]) {
+                continue;
+            }
+            const size_t firstBlock = state.starts[b] / info.perBlock;
+            const size_t lastBlock  = (state.starts[b + 1] - 1) / info.perBlock;
+            for (size_t blockTag = firstBlock; blockTag <= lastBlock; blockTag++) {
+                if (getOwnerRank(blockTag) == rank) {
+                    state.expectedWrites++;
+                    break;
+                }
+            }
+        }
+        state.exchanged = true;
+        break;
+    }
+    case SortInfo::DATA:
+        state.bucket.insert(state.bucket.end(), data, data + dataSize);
+        state.parts++;
+        break;
+    case SortInfo::WRITE: {
+        // Records of (blockTag, first value, count) followed by values
+        const int blockSize = info.perBlock * valueSize;
+        for (size_t pos = 0; pos < dataSize;) {
+            unsigned long long record[3];
+            std::copy_n(data + pos, sizeof(record), reinterpret_cast<char*>(record));
+            pos += sizeof(record);
+            MessagePtr& block = ownedBlock(msg->dsTag, record[0], blockSize);
+            std::copy_n(data + pos, record[2] * valueSize,
+                        block->getPayload() + record[1] * valueSize);
+            pos += record[2] * valueSize;
+        }
+        state.writes++;
+        break;
+    }
+    default:
+        throw PC2L_EXP("Invalid sort step %d", "Need to implement?", info.step);
+    }
+    progressSort(msg->dsTag);
+}
+
+void
+CacheWorker::progressSort(unsigned int dsTag) {
+    SortState& state    = sorts[dsTag];
+    const int rank      = MPI_GET_RANK();
+    const int workers   = System::get().worldSize() - 1;
+    const Kernel& kernel = System::get().getKernel(state.info.kernel);
+    const int valueSize = kernel.valueSize();
+    if (state.exchanged && !state.written && state.parts == workers) {
+        // All parts of our bucket have arrived. Sort it and write it
+        // into its blocks, with one message per worker owning them.
+        kernel.sort(state.bucket.data(), state.bucket.size() / valueSize);
+        std::vector<std::vector<char>> writes(workers);
+        const unsigned long long perBlock = state.info.perBlock;
+        const unsigned long long end      = state.starts[rank];
+        const char* src = state.bucket.data();
+        for (unsigned long long pos = state.starts[rank - 1]; pos < end;) {
+            const unsigned long long record[3] = {
+                pos / perBlock, pos % perBlock,
+                std::min(perBlock - pos % perBlock, end - pos)};
+            std::vector<char>& out = writes[getOwnerRank(record[0]) - 1];
+            out.insert(out.end(), reinterpret_cast<const char*>(record),
+                       reinterpret_cast<const char*>(record) + sizeof(record));
+            out.insert(out.end(), src, src + record[2] * valueSize);
+            src += record[2] * valueSize;
+            pos += record[2];
+        }
+        SortInfo writeInfo = state.info;
+        writeInfo.step     = SortInfo::WRITE;
+        for (int w = 0; w < workers; w++) {
+            if (writes[w].empty()) {
+                continue;
+            }
+            MessagePtr msg = Message::create(sizeof(writeInfo) + writes[w].size(),
+                                             Message::SORT, rank);
+            msg->dsTag = dsTag;
+            std::copy_n(reinterpret_cast<const char*>(&writeInfo), sizeof(writeInfo),
+                        msg->getPayload());
+            std::copy(writes[w].begin(), writes[w].end(),
+                      msg->getPayload() + sizeof(writeInfo));
+            isend(msg, w + 1);
+        }
+        std::vector<char>().swap(state.bucket);
+        state.written = true;
+    }
+    if (state.written && state.writes == state.expectedWrites) {
+        // Our blocks are final. Let the manager know.
+        MessagePtr done = Message::create(0, Message::SORT, rank);
+        done->dsTag = dsTag;
+        isend(done, state.manager);
+        sorts.erase(dsTag);
+    }
+}
+
+void
+CacheWorker::searchBlocks(const MessagePtr& msg) {
+    SearchInfo info;
+    std::copy_n(msg->getPayload(), sizeof(info), reinterpret_cast<char*>(&info));
+    const Kernel* kernel = (info.kernel < 0) ? nullptr :
+        &System::get().getKernel(info.kernel);
+    const char* target = msg->getPayload() + sizeof(info);
+    // When finding, the result is the smallest matching index
+    unsigned long long result = info.findFirst ? info.count : 0;
+    bool found = false;
+    const size_t blockCount = (info.count + info.perBlock - 1) / info.perBlock;
+    const size_t workers    = System::get().worldSize() - 1;
+    for (size_t blockTag = MPI_GET_RANK() - 1; (blockTag < blockCount) && !found;
+         blockTag += workers) {
+        const MessagePtr block = readCacheBlock(msg->dsTag, blockTag);
+        if (block == nullptr) {
+            continue;
+        }
+        const char* values = block->getPayload();
+        const unsigned long long first = blockTag * info.perBlock;
+        const unsigned long long count = std::min(info.perBlock, info.count - first);
+        for (unsigned long long i = 0; i < count; i++) {
+            const char* value = values + i * info.valueSize;
+            if (kernel != nullptr ? kernel->test(value) :
+                std::equal(value, value + info.valueSize, target)) {
+                if (info.findFirst) {
+                    result = first + i;
+                    found  = true;
+                    break;
+                }
+                result++;
+            }
+        }
+    }
+    MessagePtr reply = Message::create(sizeof(result), Message::SEARCH,
+                                       MPI_GET_RANK());
+    reply->dsTag = msg->dsTag;
+    std::copy_n(reinterpret_cast<const char*>(&result), sizeof(result),
+                reply->getPayload());
+    isend(reply, msg->srcRank);
+}
+
+std::string
+CacheWorker::getBlockFile(const std::string& dir, int rank) {
+    return dir + "/blocks-" + std::to_string(rank) + ".pc2l";
+}
+
+void
+CacheWorker::saveDataStructure(const MessagePtr& msg) {
+    unsigned long long blockCount;
+    std::copy_n(msg->getPayload(), sizeof(blockCount),
+                reinterpret_cast<char*>(&blockCount));
+    const std::string dir(msg->getPayload() + sizeof(blockCount),
+                          msg->getPayloadSize() - sizeof(blockCount));
+    // Collect the owned blocks, materializing filled or mapped ones
+    std::vector<MessagePtr> blocks;
+    const size_t workers = System::get().worldSize() - 1;
+    for (size_t blockTag = MPI_GET_RANK() - 1; blockTag < blockCount;
+         blockTag += workers) {
+        const MessagePtr block = readCacheBlock(msg->dsTag, blockTag);
+        if (block != nullptr) {
+            blocks.push_back(block);
+        }
+    }
+    // Write the index followed by the blocks
+    std::vector<unsigned long long> index = {blocks.size()};
+    unsigned long long offset = (1 + 3 * blocks.size()) * sizeof(offset);
+    for (const MessagePtr& block : blocks) {
+        index.push_back(block->blockTag);
+        index.push_back(offset);
+        index.push_back(block->getPayloadSize());
+        offset += block->getPayloadSize();
+    }
+    ::mkdir(dir.c_str(), 0755);
+    std::ofstream file(getBlockFile(dir, MPI_GET_RANK()), std::ios::binary);
+    file.write(reinterpret_cast<const char*>(index.data()),
+               index.size() * sizeof(index[0]));
+    for (const MessagePtr& block : blocks) {
+        file.write(block->getPayload(), block->getPayloadSize());
+    }
+    file.close();
+    replyStatus(msg, file ? "" : "Error writing " + getBlockFile(dir, MPI_GET_RANK()));
+}
+
+void
+CacheWorker::openDataStructure(const MessagePtr& msg) {
+    const std::string path = getBlockFile(std::string(msg->getPayload(),
+                                                      msg->getPayloadSize()),
+                                          MPI_GET_RANK());
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd == -1 || ::fstat(fd, &info) == -1) {
+        if (fd != -1) {
+            ::close(fd);
+        }
+        replyStatus(msg, path + ": " + std::strerror(errno));
+        return;
+    }
+    const size_t length = info.st_size;
+    void* addr = (length > 0) ?
+        ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    unsigned long long count = 0;
+    if (addr != MAP_FAILED) {
+        std::copy_n(static_cast<const char*>(addr), sizeof(count),
+                    reinterpret_cast<char*>(&count));
+    }
+    if (addr == MAP_FAILED || (1 + 3 * count) * sizeof(count) > length) {
+        if (addr != MAP_FAILED) {
+            ::munmap(addr, length);
+        }
+        replyStatus(msg, "Unable to map " + path);
+        return;
+    }
+    MappedFile& file = mapped[msg->dsTag];
+    file.base = std::shared_ptr<char>(static_cast<char*>(addr),
+                                      [length](char* base) { ::munmap(base, length); });
+    file.blocks.clear();
+    const char* index = file.base.get() + sizeof(count);
+    for (unsigned long long i = 0; i < count; i++) {
+        unsigned long long entry[3];
+        std::copy_n(index + i * sizeof(entry), sizeof(entry),
+                    reinterpret_cast<char*>(entry));
+        file.blocks[entry[0]] = std::make_pair(entry[1], entry[2]);
+    }
+    replyStatus(msg, "");
+}
+
+void
+CacheWorker::replyStatus(const MessagePtr& msg, const std::string& error) {
+    MessagePtr reply = Message::create(error.size(), msg->tag, MPI_GET_RANK());
+    reply->dsTag = msg->dsTag;
+    std::copy(error.begin(), error.end(), reply->getPayload());
+    isend(reply, msg->srcRank);
+}
+
+void
+CacheWorker::bitwiseBlocks(const MessagePtr& msg) {
+    BitwiseInfo info;
+    std::copy_n(msg->getPayload(), sizeof(info), reinterpret_cast<char*>(&info));
+    unsigned long long bits = 0;
+    const size_t workers = System::get().worldSize() - 1;
+    for (size_t blockTag = MPI_GET_RANK() - 1; blockTag < info.blockCount;
+         blockTag += workers) {
+        if (info.op == BIT_COUNT) {
+            const MessagePtr block = readCacheBlock(msg->dsTag, blockTag);
+            if (block == nullptr) {
+                continue;
+            }
+            const char* words = block->getPayload();
+            for (int pos = 0; pos < block->getPayloadSize(); pos += 8) {
+                unsigned long long word;
+                std::copy_n(words + pos, 8, reinterpret_cast<char*>(&word));
+                bits += __builtin_popcountll(word);
+            }
+            continue;
+        }
+        // The source block is held so that creating the destination
+        // block cannot evict it
+        const MessagePtr srcBlock = readCacheBlock(info.srcDs, blockTag);
+        if (srcBlock == nullptr && info.op != BIT_AND) {
+            continue;  // x | 0 == x ^ 0 == x
+        }
+        char* dest = ownedBlock(msg->dsTag, blockTag, info.blockSize)->getPayload();
+        for (unsigned long long pos = 0; pos < info.blockSize; pos += 8) {
+            unsigned long long word = 0, other = 0;
+            std::copy_n(dest + pos, 8, reinterpret_cast<char*>(&word));
+            if (srcBlock != nullptr) {
+                std::copy_n(srcBlock->getPayload() + pos, 8,
+                            reinterpret_cast<char*>(&other));
+            }
+            word = (info.op == BIT_AND) ? (word & other) :
+                (info.op == BIT_OR) ? (word | other) : (word ^ other);
+            std::copy_n(reinterpret_cast<const char*>(&word), 8, dest + pos);
+        }
+    }
+    MessagePtr reply = Message::create(sizeof(bits), Message::BITWISE,
+                                       MPI_GET_RANK());
+    reply->dsTag = msg->dsTag;
+    std::copy_n(reinterpret_cast<const char*>(&bits), sizeof(bits),
+                reply->getPayload());
+    isend(reply, msg->srcRank);
+}
+
+MessagePtr&
+CacheWorker::ownedBlock(unsigned int dsTag, size_t blockTag, int blockSize) {
+    const size_t key = getKey(dsTag, blockTag);
+    if (findCacheBlock(dsTag, blockTag) == cache.end()) {
+        MessagePtr block = Message::create(blockSize, Message::STORE_BLOCK,
+                                           MPI_GET_RANK());
+        block->dsTag    = dsTag;
+        block->blockTag = blockTag;
+        storeCacheBlock(block);
+    }
+    return writableBlock(cache[key]);
+}
+
+MessagePtr
+CacheWorker::materializeBlock(unsigned int dsTag, size_t blockTag) {
+    const auto entry = fills.find(dsTag);
+    if (entry != fills.end()) {
+        // Later fills override earlier ones, so search from the latest
+        for (auto fill = entry->second.rbegin(); fill != entry->second.rend(); fill++) {
+            const MessagePtr& fillMsg = *fill;
+            FillInfo info;
+            std::copy_n(fillMsg->getPayload(), sizeof(info),
+                        reinterpret_cast<char*>(&info));
+            if (blockTag < fillMsg->blockTag || blockTag >= info.lastBlock) {
+                continue;
+            }
+            // Repeat the value to fill the whole block
+            const char* value   = fillMsg->getPayload() + sizeof(info);
+            const int valueSize = fillMsg->getPayloadSize() - sizeof(info);
+            MessagePtr block = Message::create(info.blockSize, Message::STORE_BLOCK,
+                                               MPI_GET_RANK());
+            block->dsTag    = dsTag;
+            block->blockTag = blockTag;
+            for (int pos = 0; pos + valueSize <= block->getPayloadSize(); pos += valueSize) {
+                std::copy_n(value, valueSize, block->getPayload() + pos);
+            }
+            storeCacheBlock(block);
+            return block;
+        }
+    }
+    // Otherwise, the block may be in a mapped file
+    const auto file = mapped.find(dsTag);
+    if (file == mapped.end()) {
+        return nullptr;
+    }
+    const auto pos = file->second.blocks.find(blockTag);
+    if (pos == file->second.blocks.end()) {
+        return nullptr;
+    }
+    MessagePtr block = Message::create(pos->second.second, Message::STORE_BLOCK,
+                                       MPI_GET_RANK());
+    block->dsTag    = dsTag;
+    block->blockTag = blockTag;
+    std::copy_n(file->second.base.get() + pos->second.first, pos->second.second,
+                block->getPayload());
+    storeCacheBlock(block);
+    return block;
+}
+
+void
+CacheWorker::dropCacheBlock(size_t key) {
+    const auto entry = cache.find(key);
+    if (entry != cache.end()) {
+        cachedBytes -= entry->second->getSize();
+        cache.erase(entry);
+        eviction->erase(key);
+    }
+}
+
+void
+CacheWorker::dropCacheBlocks(unsigned int dsTag, size_t firstBlock,
+                             size_t lastBlock) {
+    std::vector<size_t> keys;
+    for (const auto& entry : cache) {
+        const MessagePtr& block = entry.second;
+        if (block->dsTag == dsTag &&
+            block->blockTag >= firstBlock && block->blockTag < lastBlock) {
+            keys.push_back(entry.first);
+        }
+    }
+    for (const size_t key : keys) {
+        dropCacheBlock(key);
+    }
+}
+
+MessagePtr&
+CacheWorker::writableBlock(MessagePtr& block) {
+    // A block that is still being sent (see Worker::isend) must not
+    // be modified. So the cache entry is switched to a copy instead.
+    if (block.use_count() > 1) {
+        block = Message::create(*block);
+    }
+    return block;
+}
+
+void
+CacheWorker::patchCacheBlock(const MessagePtr& msg) {
+    const auto entry = findCacheBlock(msg->dsTag, msg->blockTag);
+    if (entry == cache.end()) {
+        return;
+    }
+    MessagePtr& block = writableBlock(entry->second);
+    const char* patch = msg->getPayload();
+    const char* end   = patch + msg->getPayloadSize();
+    while (patch < end) {
+        unsigned int range[2];
+        std::copy_n(patch, sizeof(range), reinterpret_cast<char*>(range));
+        patch += sizeof(range);
+        std::copy_n(patch, range[1], block->getPayload() + range[0]);
+        patch += range[1];
+    }
+}
+
+DataCache::iterator
+CacheWorker::findCacheBlock(unsigned int dsTag, size_t blockTag,
+                            bool decode) {
+    const size_t key = getKey(dsTag, blockTag);
+    auto entry = cache.find(key);
+    if (entry == cache.end() && materializeBlock(dsTag, blockTag) != nullptr) {
+        entry = cache.find(key);
+    }
+    if (decode && entry != cache.end() &&
+        entry->second->tag == Message::ENCODED_BLOCK) {
+        // Blocks that are modified in place are kept decoded
+        cachedBytes -= entry->second->getSize();
+        entry->second = BlockCodec::decodeBlock(entry->second);
+        cachedBytes += entry->second->getSize();
+    }
+    return entry;
+}
+
+MessagePtr
+CacheWorker::readCacheBlock(unsigned int dsTag, size_t blockTag) {
+    const auto entry = findCacheBlock(dsTag, blockTag, false);
+    if (entry == cache.end()) {
+        return nullptr;
+    }
+    return (entry->second->tag == Message::ENCODED_BLOCK) ?
+        BlockCodec::decodeBlock(entry->second) : entry->second;
+}
+
+void
+CacheWorker::gatherValues(const MessagePtr& msg) {
+    GatherInfo info;
+    std::copy_n(msg->getPayload(), sizeof(info), reinterpret_cast<char*>(&info));
+    const char* locations = msg->getPayload() + sizeof(info);
+    MessagePtr reply = Message::create(info.count * info.valueSize,
+                                       Message::GATHER, MPI_GET_RANK());
+    reply->dsTag = msg->dsTag;
+    char* values = reply->getPayload();
+    std::fill_n(values, info.count * info.valueSize, 0);
+    // Consecutive values in the same block share one decoded copy
+    MessagePtr block;
+    for (unsigned long long i = 0; i < info.count; i++) {
+        unsigned long long location[2];
+        std::copy_n(locations + i * sizeof(location), sizeof(location),
+                    reinterpret_cast<char*>(location));
+        if (block == nullptr || block->blockTag != location[0]) {
+            block = readCacheBlock(msg->dsTag, location[0]);
+        }
+        if (block != nullptr) {
+            std::copy_n(block->getPayload() + location[1], info.valueSize,
+                        values + i * info.valueSize);
+        }
+    }
+    isend(reply, msg->srcRank);
+}
+
+void
+CacheWorker::scatterValues(const MessagePtr& msg) {
+    GatherInfo info;
+    std::copy_n(msg->getPayload(), sizeof(info), reinterpret_cast<char*>(&info));
+    const char* locations = msg->getPayload() + sizeof(info);
+    const char* values    = locations + info.count * 2 * sizeof(unsigned long long);
+    for (unsigned long long i = 0; i < info.count; i++) {
+        unsigned long long location[2];
+        std::copy_n(locations + i * sizeof(location), sizeof(location),
+                    reinterpret_cast<char*>(location));
+        const auto entry = findCacheBlock(msg->dsTag, location[0]);
+        if (entry != cache.end()) {
+            std::copy_n(values + i * info.valueSize, info.valueSize,
+                        writableBlock(entry->second)->getPayload() + location[1]);
+        }
+    }
+}
+
+void
+CacheWorker::shiftBlock(char* block, int blockSize, int offset, bool right,
+                        const char* carryIn, int carryLen, char* carryOut) {
+    // Number of bytes in the block that participate in the shift
+    const int span = blockSize - offset;
+    char* start = block + offset;
+    if (right && carryLen <= span) {
+        std::copy_n(block + blockSize - carryLen, carryLen, carryOut);
+        std::copy_backward(start, block + blockSize - carryLen, block + blockSize);
+        std::copy_n(carryIn, carryLen, start);
+    } else if (right) {
+        // The carry is longer than the span, so all of the span and
+        // the tail end of the carry fall out of the block.
+        std::copy(carryIn + span, carryIn + carryLen, carryOut);
+        std::copy_n(start, span, carryOut + carryLen - span);
+        std::copy_n(carryIn, span, start);
+    } else if (carryLen <= span) {
+        std::copy_n(start, carryLen, carryOut);
+        std::copy(start + carryLen, block + blockSize, start);
+        std::copy_n(carryIn, carryLen, block + blockSize - carryLen);
+    } else {
+        // The carry is longer than the span, so all of the span and
+        // the front of the carry fall out of the block.
+        std::copy_n(start, span, carryOut);
+        std::copy_n(carryIn, carryLen - span, carryOut + span);
+        std::copy(carryIn + carryLen - span, carryIn + carryLen, start);
+    }
+}
+
 END_NAMESPACE(pc2l);
 // }   // end namespace pc2l
 
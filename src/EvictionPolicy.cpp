@@ -0,0 +1,254 @@
+#ifndef EVICTION_POLICY_CPP
+#define EVICTION_POLICY_CPP
+
+//---------------------------------------------------------------------
+//  ____ 
+// |  _ \    This file is part of  PC2L:  A Parallel & Cloud Computing 
+// | |_) |   Library <http://www.pc2lab.cec.miamioh.edu/pc2l>. PC2L is 
+// |  __/    free software: you can  redistribute it and/or  modify it
+// |_|       under the terms of the GNU  General Public License  (GPL)
+//           as published  by  the   Free  Software Foundation, either
+//           version 3 (GPL v3), or  (at your option) a later version.
+//    
+//   ____    PC2L  is distributed in the hope that it will  be useful,
+//  / ___|   but   WITHOUT  ANY  WARRANTY;  without  even  the IMPLIED
+// | |       WARRANTY of  MERCHANTABILITY  or FITNESS FOR A PARTICULAR
+// | |___    PURPOSE.
+//  \____| 
+//            Miami University and  the PC2Lab development team make no
+//            representations  or  warranties  about the suitability of
+//  ____      the software,  either  express  or implied, including but
+// |___ \     not limited to the implied warranties of merchantability,
+//   __) |    fitness  for a  particular  purpose, or non-infringement.
+//  / __/     Miami  University and  its affiliates shall not be liable
+// |_____|    for any damages  suffered by the  licensee as a result of
+//            using, modifying,  or distributing  this software  or its
+//            derivatives.
+//
+//  _         By using or  copying  this  Software,  Licensee  agree to
+// | |        abide  by the intellectual  property laws,  and all other
+// | |        applicable  laws of  the U.S.,  and the terms of the  GNU
+// | |___     General  Public  License  (version 3).  You  should  have
+// |_____|    received a  copy of the  GNU General Public License along
+//            with MUSE.  If not,  you may  download  copies  of GPL V3
+//            from <http://www.gnu.org/licenses/>.
+//
+// --------------------------------------------------------------------
+// Authors:   Dhananjai M. Rao          raodm@miamioh.edu
+//---------------------------------------------------------------------
+
+#include <algorithm>
+#include "EvictionPolicy.h"
+
+BEGIN_NAMESPACE(pc2l);
+
+void
+RecencyPolicy::insert(size_t key) {
+    order.push_front(key);
+    places[key] = order.begin();
+}
+
+void
+RecencyPolicy::access(size_t key) {
+    // Move the key to the front without reallocating its node
+    order.splice(order.begin(), order, places.at(key));
+}
+
+void
+RecencyPolicy::erase(size_t key) {
+    const auto entry = places.find(key);
+    if (entry != places.end()) {
+        order.erase(entry->second);
+        places.erase(entry);
+    }
+}
+
+bool
+RecencyPolicy::evict(size_t, const std::function<bool(size_t)>& evictable,
+                     size_t& victim) {
+    if (mostRecent) {
+        const auto pos = std::find_if(order.begin(), order.end(), evictable);
+        if (pos == order.end()) {
+            return false;
+        }
+        victim = *pos;
+    } else {
+        const auto pos = std::find_if(order.rbegin(), order.rend(), evictable);
+        if (pos == order.rend()) {
+            return false;
+        }
+        victim = *pos;
+    }
+    erase(victim);
+    return true;
+}
+
+void
+LfuPolicy::insert(size_t key) {
+    const Usage usage(1, time++, key);
+    order.insert(usage);
+    usages[key] = usage;
+}
+
+void
+LfuPolicy::access(size_t key) {
+    Usage& usage = usages.at(key);
+    order.erase(usage);
+    usage = Usage(std::get<0>(usage) + 1, time++, key);
+    order.insert(usage);
+}
+
+void
+LfuPolicy::erase(size_t key) {
+    const auto entry = usages.find(key);
+    if (entry != usages.end()) {
+        order.erase(entry->second);
+        usages.erase(entry);
+    }
+}
+
+bool
+LfuPolicy::evict(size_t, const std::function<bool(size_t)>& evictable,
+                 size_t& victim) {
+    for (const Usage& usage : order) {
+        if (evictable(std::get<2>(usage))) {
+            victim = std::get<2>(usage);
+            erase(victim);
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+ClockPolicy::insert(size_t key) {
+    size_t slot = slots.size();
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        slots.push_back(Slot());
+    }
+    slots[slot] = {key, false, true};
+    slotOf[key] = slot;
+}
+
+void
+ClockPolicy::access(size_t key) {
+    slots[slotOf.at(key)].referenced = true;
+}
+
+void
+ClockPolicy::erase(size_t key) {
+    const auto entry = slotOf.find(key);
+    if (entry != slotOf.end()) {
+        slots[entry->second].used = false;
+        freeSlots.push_back(entry->second);
+        slotOf.erase(entry);
+    }
+}
+
+bool
+ClockPolicy::evict(size_t, const std::function<bool(size_t)>& evictable,
+                   size_t& victim) {
+    // After one sweep all reference bits are clear, so two sweeps
+    // find a victim unless all the blocks are pinned
+    for (size_t step = 0; step < 2 * slots.size(); step++) {
+        Slot& slot = slots[hand];
+        hand = (hand + 1) % slots.size();
+        if (!slot.used) {
+            continue;
+        }
+        if (slot.referenced) {
+            slot.referenced = false;
+        } else if (evictable(slot.key)) {
+            victim = slot.key;
+            erase(victim);
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+ArcPolicy::moveTo(size_t key, ListId to) {
+    const auto entry = places.find(key);
+    if (entry != places.end()) {
+        lists[entry->second.first].erase(entry->second.second);
+    }
+    lists[to].push_front(key);
+    places[key] = std::make_pair(to, lists[to].begin());
+}
+
+void
+ArcPolicy::trimGhosts() {
+    while (lists[T1].size() + lists[B1].size() > capacity && !lists[B1].empty()) {
+        places.erase(lists[B1].back());
+        lists[B1].pop_back();
+    }
+    while (places.size() > 2 * capacity && !lists[B2].empty()) {
+        places.erase(lists[B2].back());
+        lists[B2].pop_back();
+    }
+}
+
+void
+ArcPolicy::insert(size_t key) {
+    const auto entry = places.find(key);
+    const ListId ghost = (entry != places.end()) ? entry->second.first : T1;
+    if (ghost == B1) {
+        // T1 was too short to keep this block: favor T1
+        const size_t delta = std::max<size_t>(1, lists[B2].size() / lists[B1].size());
+        target = std::min(capacity, target + delta);
+        moveTo(key, T2);
+    } else if (ghost == B2) {
+        // T2 was too short to keep this block: favor T2
+        const size_t delta = std::max<size_t>(1, lists[B1].size() / lists[B2].size());
+        target -= std::min(target, delta);
+        moveTo(key, T2);
+    } else {
+        moveTo(key, T1);
+    }
+    capacity = std::max(capacity, lists[T1].size() + lists[T2].size());
+    trimGhosts();
+}
+
+void
+ArcPolicy::access(size_t key) {
+    moveTo(key, T2);
+}
+
+void
+ArcPolicy::erase(size_t key) {
+    const auto entry = places.find(key);
+    if (entry != places.end()) {
+        lists[entry->second.first].erase(entry->second.second);
+        places.erase(entry);
+    }
+}
+
+bool
+ArcPolicy::evict(size_t incoming, const std::function<bool(size_t)>& evictable,
+                 size_t& victim) {
+    const auto entry = places.find(incoming);
+    const bool inB2  = (entry != places.end()) && (entry->second.first == B2);
+    const size_t t1  = lists[T1].size();
+    const bool fromT1 = (t1 > 0) && ((t1 > target) || (inB2 && t1 == target));
+    // Evict from the preferred list, or from the other one if all
+    // the blocks in the preferred list are pinned
+    for (const ListId list : {fromT1 ? T1 : T2, fromT1 ? T2 : T1}) {
+        const auto pos = std::find_if(lists[list].rbegin(), lists[list].rend(),
+                                      evictable);
+        if (pos != lists[list].rend()) {
+            victim = *pos;
+            moveTo(victim, (list == T1) ? B1 : B2);
+            trimGhosts();
+            return true;
+        }
+    }
+    return false;
+}
+
+END_NAMESPACE(pc2l);
+
+#endif
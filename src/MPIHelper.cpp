@@ -92,6 +92,22 @@ int MPI_SEND(const void* data, int count, int type, int rank, int tag) {
     return -1;
 }
 
+int MPI_ISEND(const void* data, int count, int type, int rank, int tag,
+              MPI_REQUEST& request) {
+    UNUSED_PARAM(data);
+    UNUSED_PARAM(count);
+    UNUSED_PARAM(type);
+    UNUSED_PARAM(rank);
+    UNUSED_PARAM(tag);
+    UNUSED_PARAM(request);
+    return -1;
+}
+
+bool MPI_TEST(MPI_REQUEST& request) {
+    UNUSED_PARAM(request);
+    return true;
+}
+
 #endif  // Don't have MPI
 
 END_NAMESPACE(pc2l);
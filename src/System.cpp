@@ -97,6 +97,7 @@ System::stop() {
     if (MPI_GET_RANK() == 0) {
         manager.finalize();
     }
+    running = false;
 }
 
 void
@@ -112,6 +113,7 @@ System::oneWriterDistribCache() {
         // We assume this process is the manager.
         manager.initialize();
         manager.run();
+        running = true;
     } else {
         // Here this process is running as a worker.  So perform the
         // worker's lifecycle activities here.
@@ -126,6 +128,18 @@ void System::setCacheSize(unsigned long long cSize) noexcept {
     manager.cacheSize = cSize;
 }
 
+void System::setPrefetchDepth(int depth) noexcept {
+    manager.prefetchDepth = depth;
+}
+
+void System::setStoreDepth(int depth) noexcept {
+    manager.storeDepth = depth;
+}
+
+void System::setEvictionStrategy(CacheWorker::EvictionStrategy strategy) {
+    manager.setEvictionStrategy(strategy);
+}
+
 void System::setBlockSize(unsigned int bSize) noexcept {
     blockSize = bSize;
 }
@@ -134,6 +148,54 @@ unsigned int System::getBlockSize() noexcept {
     return blockSize;
 }
 
+bool System::isRunning() const noexcept {
+    return running;
+}
+
+int System::registerKernel(Kernel* kernel) {
+    std::unique_ptr<Kernel> owned(kernel);
+    if (running) {
+        throw PC2L_EXP("Kernels cannot be registered after the system has started",
+                       "Register kernels before calling System::start()");
+    }
+    kernels.push_back(std::move(owned));
+    return kernels.size() - 1;
+}
+
+Kernel& System::getKernel(int id) {
+    if (id < 0 || id >= static_cast<int>(kernels.size())) {
+        throw PC2L_EXP("Kernel %d has not been registered",
+                       "Register kernels on all processes in the same order", id);
+    }
+    return *kernels[id];
+}
+
+int System::registerCodec(BlockCodec* codec) {
+    std::unique_ptr<BlockCodec> owned(codec);
+    if (running) {
+        throw PC2L_EXP("Codecs cannot be registered after the system has started",
+                       "Register codecs before calling System::start()");
+    }
+    codecs.push_back(std::move(owned));
+    return BlockCodec::BUILT_IN_COUNT + codecs.size() - 1;
+}
+
+BlockCodec& System::getCodec(int id) {
+    static DeltaCodec delta;
+    static ShuffleRleCodec shuffleRle;
+    switch (id) {
+    case BlockCodec::DELTA:       return delta;
+    case BlockCodec::SHUFFLE_RLE: return shuffleRle;
+    default: break;
+    }
+    const int index = id - BlockCodec::BUILT_IN_COUNT;
+    if (index < 0 || index >= static_cast<int>(codecs.size())) {
+        throw PC2L_EXP("Codec %d has not been registered",
+                       "Register codecs on all processes in the same order", id);
+    }
+    return *codecs[index];
+}
+
 END_NAMESPACE(pc2l);
 // }   // end namespace pc2l
 
@@ -47,10 +47,104 @@
 
 BEGIN_NAMESPACE(pc2l);
 
+VectorBase::VectorBase(unsigned long long bSize, unsigned long long perBlock) :
+    dsTag(System::get().dsCount++), blockSize(bSize), siz(0),
+    elemsPerBlock(perBlock) {
+}
 
+VectorBase::VectorBase(const VectorBase& other) :
+    dsTag(System::get().dsCount++), blockSize(other.blockSize), siz(0),
+    elemsPerBlock(other.elemsPerBlock) {
+    other.flush();
+    System::get().cacheManager().cloneDataStructure(other.dsTag, dsTag);
+    siz = other.siz;
+}
 
+VectorBase::VectorBase(VectorBase&& other) :
+    dsTag(other.dsTag), blockSize(other.blockSize), siz(0),
+    elemsPerBlock(other.elemsPerBlock) {
+    // The tail block of other is published so that its blocks are
+    // complete when they are taken over.
+    other.flush();
+    siz = other.siz;
+    other.dsTag = System::get().dsCount++;
+    other.siz   = 0;
+}
 
+VectorBase&
+VectorBase::operator=(VectorBase&& other) {
+    if (this != &other) {
+        clear();
+        other.flush();
+        std::swap(dsTag, other.dsTag);
+        std::swap(blockSize, other.blockSize);
+        std::swap(elemsPerBlock, other.elemsPerBlock);
+        std::swap(siz, other.siz);
+    }
+    return *this;
+}
 
+VectorBase&
+VectorBase::operator=(const VectorBase& other) {
+    if (this != &other) {
+        clear();
+        other.flush();
+        System::get().cacheManager().cloneDataStructure(other.dsTag, dsTag);
+        blockSize     = other.blockSize;
+        elemsPerBlock = other.elemsPerBlock;
+        siz           = other.siz;
+    }
+    return *this;
+}
+
+VectorBase::~VectorBase() {
+    if (System::get().isRunning()) {
+        clear();
+        System::get().cacheManager().setCodec(dsTag, BlockCodec::NONE, 0);
+        setWritePolicy(CacheManager::WRITE_BACK);
+    }
+}
+
+void
+VectorBase::clear() {
+    dropTail();
+    System::get().cacheManager().dropDataStructure(dsTag);
+    siz = 0;
+}
+
+void
+VectorBase::flush() const {
+    if (tailBlock != nullptr) {
+        System::get().cacheManager().markDirty(tailBlock);
+        tailBlock = nullptr;
+    }
+}
+
+void
+VectorBase::dropTail() {
+    tailBlock = nullptr;
+}
+
+MessagePtr
+VectorBase::findBlock(size_t blockTag) const {
+    if (tailBlock != nullptr && tailBlock->blockTag == blockTag) {
+        return tailBlock;
+    }
+    return System::get().cacheManager().getBlock(CacheWorker::getKey(dsTag, blockTag));
+}
+
+MessagePtr
+VectorBase::fetchBlock(size_t blockTag) const {
+    CacheManager& cm = System::get().cacheManager();
+    MessagePtr msg = findBlock(blockTag);
+    if (msg == nullptr) {
+        // otherwise, we have to get it from a remote cacheworker
+        msg = cm.fetchBlock(dsTag, blockTag);
+    }
+    // let the CacheManager detect access patterns and prefetch
+    cm.recordAccess(dsTag, blockTag, blockCount(), blockSize);
+    return msg;
+}
 
 END_NAMESPACE(pc2l)
 #endif
@@ -36,6 +36,7 @@
 // --------------------------------------------------------------------
 // Authors:   Dhananjai M. Rao          raodm@miamioh.edu
 //---------------------------------------------------------------------
+#include <algorithm>
 #include "Utilities.h"
 #include "Exception.h"
 #include "Worker.h"
@@ -54,6 +55,41 @@ Worker::send(MessagePtr msgPtr, const int destRank) {
     }
 }
 
+// Start sending a message, keeping it alive until the send completes
+void
+Worker::isend(MessagePtr msgPtr, const int destRank) {
+    // Send message only if the pointer is set
+    if (msgPtr) {
+        pendingSends.push_back({MPI_REQUEST(), msgPtr});
+        MPI_ISEND(msgPtr.get(), msgPtr->getSize(), MPI_TYPE_CHAR, destRank,
+                  msgPtr->tag, pendingSends.back().first);
+    }
+}
+
+void
+Worker::completeSends(const bool wait) {
+    // Retain only the sends that are still in progress
+    auto done = std::remove_if(pendingSends.begin(), pendingSends.end(),
+                               [wait](std::pair<MPI_REQUEST, MessagePtr>& send) {
+                                   if (wait) {
+                                       MPI_WAIT(send.first);
+                                       return true;
+                                   }
+                                   return MPI_TEST(send.first);
+                               });
+    pendingSends.erase(done, pendingSends.end());
+}
+
+void
+Worker::limitSends(const size_t maxPending) {
+    completeSends();
+    // Sends complete roughly in the order they were started
+    while (pendingSends.size() > maxPending) {
+        MPI_WAIT(pendingSends.front().first);
+        pendingSends.erase(pendingSends.begin());
+    }
+}
+
 // Recieve a message using our recv buffer
 MessagePtr
 Worker::recv(const int srcRank, const bool blocking,
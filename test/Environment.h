@@ -16,8 +16,8 @@ public:
         // set block size to 5 integers
         auto& pc2l = pc2l::System::get();
         pc2l.setBlockSize(sizeof(int) * 5);
-        // set cache size to 3 blocks
-        pc2l.setCacheSize(3*5*sizeof(int));
+        // set cache size to 3 blocks, including their headers
+        pc2l.setCacheSize(3*(5*sizeof(int) + sizeof(pc2l::Message)));
         pc2l.initialize(argc, argv);
         pc2l.start();
         ::testing::TestEventListeners& listeners =
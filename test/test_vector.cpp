@@ -34,17 +34,49 @@
 // Authors:   JD Rudie                             rudiejd@miamioh.edu
 //---------------------------------------------------------------------
 
+#include <dirent.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <limits>
+#include <list>
+#include <numeric>
+#include <string>
+#include <vector>
 #include "Environment.h"
 
 
 class VectorTest : public ::testing::Test {
-
+protected:
+    void SetUp() override {
+        // The tests drive the vector from the manager process. The
+        // other processes only serve as cache workers until the
+        // manager finishes, so they must not run the tests themselves.
+        int rank;
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+        if (rank != 0) {
+            GTEST_SKIP();
+        }
+    }
 };
 
+// Kernels used by the tests. They are registered on all processes
+// before the workers are started.
+int squareKernel, negateKernel, sumKernel, maxKernel, ascendingKernel,
+    descendingKernel, negativeKernel;
+
 int main(int argc, char *argv[]) {
     for (int i = 0; i < argc; i++) std::cout << argv[i] << std::endl;
     ::testing::InitGoogleTest(&argc, argv);
+    squareKernel = pc2l::registerTransform<int>([](int x) { return x * x; });
+    negateKernel = pc2l::registerForEach<int>([](int& x) { x = -x; });
+    sumKernel    = pc2l::registerReduce<long long>(std::plus<long long>());
+    maxKernel    = pc2l::registerReduce<int>([](int a, int b) { return std::max(a, b); });
+    ascendingKernel  = pc2l::registerSort<int>();
+    descendingKernel = pc2l::registerSort<long long>(std::greater<long long>());
+    negativeKernel   = pc2l::registerPredicate<int>([](int x) { return x < 0; });
     auto env = new PC2LEnvironment();
     env->argc = argc;
     env->argv = argv;
@@ -118,6 +150,1034 @@ TEST_F(VectorTest, test_delete) {
     }
 }
 
+TEST_F(VectorTest, test_read_write) {
+    pc2l::Vector<int> intVec;
+    for (int i = 0; i < 100; i++) {
+        ASSERT_NO_THROW(intVec.insert(i, i));
+    }
+    // read back a range that starts and ends in the middle of blocks
+    std::vector<int> vals(43);
+    ASSERT_NO_THROW(intVec.read(13, vals.size(), vals.data()));
+    for (size_t i = 0; i < vals.size(); i++) {
+        ASSERT_EQ(vals[i], i + 13);
+    }
+    // overwrite a range and check it with at()
+    for (size_t i = 0; i < vals.size(); i++) {
+        vals[i] = -static_cast<int>(i);
+    }
+    ASSERT_NO_THROW(intVec.write(7, vals.size(), vals.data()));
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(intVec.at(i), (i < 7 || i >= 50) ? i : 7 - i);
+    }
+    // whole vector in one read
+    std::vector<int> all(intVec.size());
+    ASSERT_NO_THROW(intVec.read(0, all.size(), all.data()));
+    ASSERT_EQ(all[6], 6);
+    ASSERT_EQ(all[8], -1);
+    ASSERT_EQ(all[99], 99);
+    // ranges past the end are rejected
+    ASSERT_THROW(intVec.read(90, 11, all.data()), pc2l::Exception);
+}
+
+TEST_F(VectorTest, test_push_back) {
+    auto& cm = pc2l::System::get().cacheManager();
+    pc2l::Vector<int> intVec;
+    for (int i = 0; i < 7; i++) {
+        ASSERT_NO_THROW(intVec.push_back(i));
+    }
+    // the partially filled tail block is visible before it is published
+    ASSERT_EQ(intVec.at(6), 6);
+    ASSERT_EQ(cm.managerCache().count(cm.getKey(intVec.dsTag, 1)), 0);
+    ASSERT_NO_THROW(intVec.flush());
+    ASSERT_EQ(cm.managerCache().count(cm.getKey(intVec.dsTag, 1)), 1);
+    // push the partially filled block out to its cache worker
+    pc2l::Vector<int> other;
+    for (int i = 0; i < 20; i++) {
+        other.push_back(i);
+    }
+    ASSERT_EQ(cm.managerCache().count(cm.getKey(intVec.dsTag, 1)), 0);
+    // appending must continue the evicted block, not start afresh
+    std::vector<int> vals(93);
+    for (size_t i = 0; i < vals.size(); i++) {
+        vals[i] = i + 7;
+    }
+    ASSERT_NO_THROW(intVec.append(vals.data(), vals.size()));
+    ASSERT_EQ(intVec.size(), 100);
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(intVec.at(i), i);
+    }
+}
+
+TEST_F(VectorTest, test_insert_middle) {
+    pc2l::Vector<int> intVec;
+    std::vector<int> expected;
+    for (int i = 0; i < 100; i++) {
+        intVec.push_back(i);
+        expected.push_back(i);
+    }
+    // single values at the front, middle and next to the end
+    ASSERT_NO_THROW(intVec.insert(42, -42));
+    expected.insert(expected.begin() + 42, -42);
+    ASSERT_NO_THROW(intVec.insert(0, -1));
+    expected.insert(expected.begin(), -1);
+    ASSERT_NO_THROW(intVec.insert(intVec.size() - 1, -99));
+    expected.insert(expected.end() - 1, -99);
+    // a range longer than a block, inserted in the middle of a block
+    std::vector<int> vals(13);
+    for (size_t i = 0; i < vals.size(); i++) {
+        vals[i] = 1000 + i;
+    }
+    ASSERT_NO_THROW(intVec.insert(7, vals.data(), vals.size()));
+    expected.insert(expected.begin() + 7, vals.begin(), vals.end());
+    ASSERT_EQ(intVec.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        ASSERT_EQ(intVec.at(i), expected[i]);
+    }
+}
+
+TEST_F(VectorTest, test_erase_range) {
+    pc2l::Vector<int> intVec;
+    std::vector<int> expected;
+    for (int i = 0; i < 100; i++) {
+        intVec.push_back(i);
+        expected.push_back(i);
+    }
+    // a range longer than a block, starting in the middle of a block
+    ASSERT_NO_THROW(intVec.erase(3, 16));
+    expected.erase(expected.begin() + 3, expected.begin() + 16);
+    // a range within a single block
+    ASSERT_NO_THROW(intVec.erase(50, 52));
+    expected.erase(expected.begin() + 50, expected.begin() + 52);
+    // the last value
+    ASSERT_NO_THROW(intVec.erase(intVec.size() - 1));
+    expected.pop_back();
+    ASSERT_EQ(intVec.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        ASSERT_EQ(intVec.at(i), expected[i]);
+    }
+    ASSERT_THROW(intVec.erase(80, 90), pc2l::Exception);
+}
+
+TEST_F(VectorTest, test_iterator) {
+    pc2l::Vector<int> intVec;
+    for (int i = 0; i < 100; i++) {
+        intVec.push_back(i);
+    }
+    const auto& constVec = intVec;
+    ASSERT_EQ(std::accumulate(constVec.begin(), constVec.end(), 0), 4950);
+    auto found = std::lower_bound(intVec.cbegin(), intVec.cend(), 42);
+    ASSERT_EQ(found - intVec.cbegin(), 42);
+    ASSERT_EQ(*found, 42);
+    ASSERT_EQ(found[13], 55);
+    // write through iterators while blocks are evicted around them
+    for (auto& val : intVec) {
+        val = 99 - val;
+    }
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(intVec.at(i), 99 - i);
+    }
+    std::sort(intVec.begin(), intVec.end());
+    ASSERT_TRUE(std::is_sorted(intVec.cbegin(), intVec.cend()));
+    ASSERT_EQ(intVec.at(0), 0);
+    ASSERT_EQ(intVec.at(99), 99);
+}
+
+TEST_F(VectorTest, test_prefetch) {
+    auto& pc2l = pc2l::System::get();
+    auto& cm = pc2l.cacheManager();
+    pc2l::Vector<int> intVec;
+    for (int i = 0; i < 100; i++) {
+        intVec.push_back(i);
+    }
+    // the cache holds only 3 blocks, so prefetch one block at a time
+    // to keep the checks below independent of when blocks arrive
+    pc2l.setPrefetchDepth(1);
+    // scanning blocks 0, 1, 2 sequentially prefetches block 3
+    for (int i = 0; i < 15; i++) {
+        ASSERT_EQ(intVec.at(i), i);
+    }
+    ASSERT_TRUE(cm.getBlock(cm.getKey(intVec.dsTag, 3)) != nullptr);
+    // a reverse scan with a stride of 2 blocks is detected too
+    for (int i = 90; i >= 50; i -= 10) {
+        ASSERT_EQ(intVec.at(i), i);
+    }
+    ASSERT_TRUE(cm.getBlock(cm.getKey(intVec.dsTag, 8)) != nullptr);
+    // without prefetching, blocks are only fetched on demand
+    pc2l.setPrefetchDepth(0);
+    for (int i = 30; i < 45; i++) {
+        ASSERT_EQ(intVec.at(i), i);
+    }
+    ASSERT_TRUE(cm.getBlock(cm.getKey(intVec.dsTag, 9)) == nullptr);
+    pc2l.setPrefetchDepth(4);
+    // prefetched blocks do not change the values read
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(intVec.at(i), i);
+    }
+}
+
+TEST_F(VectorTest, test_block_span) {
+    pc2l::Vector<int> intVec;
+    for (int i = 0; i < 98; i++) {
+        intVec.push_back(i);
+    }
+    ASSERT_EQ(intVec.blockCount(), 20);
+    // read-only access to every block, including the partial last one
+    long long sum = 0, count = 0;
+    intVec.forEachBlock([&](size_t first, const int* data, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            ASSERT_EQ(data[i], first + i);
+            sum += data[i];
+        }
+        count += n;
+    });
+    ASSERT_EQ(count, 98);
+    ASSERT_EQ(sum, 97 * 98 / 2);
+    // modify every value in place, while blocks get evicted
+    intVec.forEachBlockWritable([](size_t, int* data, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            data[i] *= 2;
+        }
+    });
+    for (int i = 0; i < 98; i++) {
+        ASSERT_EQ(intVec.at(i), 2 * i);
+    }
+    auto span = intVec.blockSpan(19);
+    ASSERT_EQ(span.firstIndex(), 95);
+    ASSERT_EQ(span.size(), 3);
+    ASSERT_EQ(span[2], 194);
+    auto writable = intVec.writableBlockSpan(2);
+    std::fill(writable.begin(), writable.end(), -1);
+    ASSERT_EQ(intVec.at(9), 18);
+    ASSERT_EQ(intVec.at(10), -1);
+    ASSERT_EQ(intVec.at(14), -1);
+}
+
+TEST_F(VectorTest, test_block_alignment) {
+    // 20-byte blocks hold only two whole doubles
+    pc2l::Vector<double> dblVec;
+    ASSERT_EQ(dblVec.blockSize, 2 * sizeof(double));
+    for (int i = 0; i < 25; i++) {
+        dblVec.push_back(i * 0.5);
+    }
+    dblVec.insert(3, -1.0);
+    dblVec.erase(10);
+    ASSERT_EQ(dblVec.size(), 25);
+    for (int i = 0; i < 25; i++) {
+        const double expected = (i < 3) ? i * 0.5 : (i == 3) ? -1.0 :
+            (i < 10) ? (i - 1) * 0.5 : i * 0.5;
+        ASSERT_EQ(dblVec.at(i), expected);
+    }
+    // a fixed (power of two) number of values per block
+    pc2l::Vector<int, 4> fixedVec;
+    ASSERT_EQ(fixedVec.blockSize, 4 * sizeof(int));
+    ASSERT_EQ(fixedVec.valuesPerBlock(), 4);
+    for (int i = 0; i < 30; i++) {
+        fixedVec.push_back(i);
+    }
+    ASSERT_EQ(fixedVec.blockCount(), 8);
+    fixedVec.replace(13, -13);
+    int sum = 0;
+    for (int val : fixedVec) {
+        sum += val;
+    }
+    ASSERT_EQ(sum, 29 * 30 / 2 - 26);
+    ASSERT_EQ(fixedVec.blockSpan(7).size(), 2);
+    // bulk and middle insert/erase paths use the same index math
+    const std::vector<int> values = {100, 101, 102, 103, 104, 105};
+    fixedVec.insert(5, values.data(), values.size());
+    fixedVec.erase(0, 3);
+    fixedVec.write(20, 3, values.data());
+    std::vector<int> out(fixedVec.size());
+    fixedVec.read(0, out.size(), out.data());
+    ASSERT_EQ(out.size(), 33);
+    for (int i = 0; i < 33; i++) {
+        const int orig = (i < 2) ? i + 3 : (i < 8) ? 98 + i : i - 3;
+        const int expected = (i >= 20 && i < 23) ? 80 + i :
+            (orig == 13) ? -13 : orig;
+        ASSERT_EQ(out[i], expected);
+    }
+}
+
+TEST_F(VectorTest, test_resize_assign) {
+    pc2l::Vector<int> intVec;
+    for (int i = 0; i < 7; i++) {
+        intVec.push_back(i);
+    }
+    // grow, filling the rest of block 1 in place and blocks 2-5 lazily
+    intVec.resize(28, -1);
+    ASSERT_EQ(intVec.size(), 28);
+    for (int i = 0; i < 28; i++) {
+        ASSERT_EQ(intVec.at(i), (i < 7) ? i : -1);
+    }
+    intVec.replace(20, 20);
+    intVec.insert(0, 100);
+    intVec.erase(5);
+    ASSERT_EQ(intVec.at(0), 100);
+    ASSERT_EQ(intVec.at(5), 5);
+    ASSERT_EQ(intVec.at(19), -1);
+    ASSERT_EQ(intVec.at(20), 20);
+    ASSERT_EQ(intVec.at(21), -1);
+    // shrinking and growing again must not expose stale values
+    intVec.resize(3);
+    intVec.resize(12, 9);
+    for (int i = 0; i < 12; i++) {
+        ASSERT_EQ(intVec.at(i), (i < 3) ? ((i == 0) ? 100 : i - 1) : 9);
+    }
+    // assign replaces everything, including cached blocks
+    intVec.assign(1000, 42);
+    ASSERT_EQ(intVec.size(), 1000);
+    long long sum = 0;
+    for (int val : intVec) {
+        sum += val;
+    }
+    ASSERT_EQ(sum, 42 * 1000);
+    intVec.push_back(7);
+    ASSERT_EQ(intVec.at(999), 42);
+    ASSERT_EQ(intVec.at(1000), 7);
+    // repeated fills replace the fills they cover
+    for (int round = 0; round < 50; round++) {
+        intVec.resize(10 + round % 3);
+        intVec.resize(200, round);
+    }
+    ASSERT_EQ(intVec.at(150), 49);
+    ASSERT_EQ(intVec.at(11), 49);
+    ASSERT_EQ(intVec.at(10), 48);
+    ASSERT_EQ(intVec.at(9), 42);
+}
+
+TEST_F(VectorTest, test_clear) {
+    pc2l::Vector<int> intVec;
+    for (int i = 0; i < 40; i++) {
+        intVec.push_back(i);
+    }
+    intVec.clear();
+    ASSERT_EQ(intVec.size(), 0);
+    // the blocks are gone from the manager and the workers
+    ASSERT_THROW(intVec.blockSpan(0), pc2l::Exception);
+    ASSERT_THROW(intVec.blockSpan(7), pc2l::Exception);
+    for (int i = 0; i < 12; i++) {
+        intVec.push_back(-i);
+    }
+    for (int i = 0; i < 12; i++) {
+        ASSERT_EQ(intVec.at(i), -i);
+    }
+    // a moved vector keeps its blocks, which are freed only once
+    pc2l::Vector<int> moved(std::move(intVec));
+    ASSERT_EQ(intVec.size(), 0);
+    ASSERT_EQ(moved.size(), 12);
+    {
+        pc2l::Vector<int> temp;
+        temp.assign(30, 5);
+        temp = std::move(moved);
+        ASSERT_EQ(temp.at(11), -11);
+    }
+    ASSERT_EQ(moved.size(), 0);
+}
+
+TEST_F(VectorTest, test_subscript) {
+    pc2l::Vector<int> intVec;
+    for (int i = 0; i < 50; i++) {
+        intVec.push_back(i);
+    }
+    for (int i = 0; i < 50; i++) {
+        intVec[i] += i;
+    }
+    for (int i = 0; i < 50; i++) {
+        ASSERT_EQ(intVec[i], 2 * i);
+    }
+    ++intVec[3];
+    ASSERT_EQ(intVec[3]++, 7);
+    ASSERT_EQ(intVec.at(3), 8);
+    intVec[4] *= 3;
+    intVec[5] -= 20;
+    intVec[6] <<= 2;
+    intVec[0] = intVec[49];
+    ASSERT_EQ(intVec.at(4), 24);
+    ASSERT_EQ(intVec.at(5), -10);
+    ASSERT_EQ(intVec.at(6), 48);
+    ASSERT_EQ(intVec.at(0), 98);
+    // updates through the proxy survive eviction of the block
+    for (int i = 10; i < 50; i++) {
+        ASSERT_EQ(intVec.at(i), 2 * i);
+    }
+    const pc2l::Vector<int>& constVec = intVec;
+    ASSERT_EQ(constVec[0], 98);
+    ASSERT_EQ(constVec[3], 8);
+}
+
+TEST_F(VectorTest, test_compute) {
+    pc2l::Vector<int> intVec;
+    for (int i = 0; i < 47; i++) {
+        intVec.push_back(i);
+    }
+    // some blocks are cached (and modified) on the manager
+    intVec[1] = 100;
+    pc2l::transform(intVec, squareKernel);
+    for (int i = 0; i < 47; i++) {
+        ASSERT_EQ(intVec.at(i), (i == 1) ? 10000 : i * i);
+    }
+    ASSERT_EQ(pc2l::reduce(intVec, 0, maxKernel), 10000);
+    pc2l::for_each(intVec, negateKernel);
+    ASSERT_EQ(intVec.at(46), -46 * 46);
+    ASSERT_EQ(pc2l::reduce(intVec, 5, maxKernel), 5);
+    // lazily filled blocks are reduced without moving them
+    pc2l::Vector<long long> llVec;
+    llVec.assign(1000, 3);
+    llVec.push_back(10);
+    ASSERT_EQ(pc2l::reduce(llVec, 1LL, sumKernel), 3011);
+    llVec.clear();
+    ASSERT_EQ(pc2l::reduce(llVec, 1LL, sumKernel), 1);
+    // kernels must match the type of values in the vector
+    ASSERT_THROW(pc2l::reduce(intVec, 0, sumKernel), pc2l::Exception);
+}
+
+TEST_F(VectorTest, test_sort) {
+    pc2l::Vector<int> intVec;
+    std::vector<int> expected;
+    for (int i = 0; i < 203; i++) {
+        const int val = (i * 7919) % 101 - 50;
+        intVec.push_back(val);
+        expected.push_back(val);
+    }
+    intVec[3] = 1000;
+    expected[3] = 1000;
+    pc2l::sort(intVec, ascendingKernel);
+    std::sort(expected.begin(), expected.end());
+    ASSERT_EQ(intVec.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        ASSERT_EQ(intVec.at(i), expected[i]);
+    }
+    // lazily filled blocks and many duplicates
+    pc2l::Vector<long long> llVec;
+    llVec.assign(60, 1);
+    llVec.push_back(5);
+    llVec.resize(90, 3);
+    pc2l::sort(llVec, descendingKernel);
+    ASSERT_EQ(llVec.size(), 90);
+    for (int i = 0; i < 90; i++) {
+        ASSERT_EQ(llVec.at(i), (i == 0) ? 5 : (i <= 29) ? 3 : 1);
+    }
+    ASSERT_THROW(pc2l::sort(intVec, squareKernel), pc2l::Exception);
+}
+
+TEST_F(VectorTest, test_range_construction) {
+    std::vector<int> values(123);
+    std::iota(values.begin(), values.end(), -10);
+    pc2l::Vector<int> intVec(values);
+    ASSERT_EQ(intVec.size(), values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        ASSERT_EQ(intVec.at(i), values[i]);
+    }
+    // the partial last block takes further appends
+    intVec.push_back(1000);
+    ASSERT_EQ(intVec.at(123), 1000);
+    // from a raw buffer, replacing the previous contents
+    const int raw[] = {5, 4, 3, 2, 1, 0, -1};
+    intVec.assign(raw, raw + 7);
+    ASSERT_EQ(intVec.size(), 7);
+    for (int i = 0; i < 7; i++) {
+        ASSERT_EQ(intVec.at(i), 5 - i);
+    }
+    // from another kind of iterator, converting values
+    std::list<short> shorts = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    pc2l::Vector<long long> llVec(shorts.begin(), shorts.end());
+    ASSERT_EQ(llVec.size(), 10);
+    long long sum = 0;
+    for (long long val : llVec) {
+        sum += val;
+    }
+    ASSERT_EQ(sum, 55);
+    // assign(n, value) still picks the fill overload
+    llVec.assign(4, 9);
+    ASSERT_EQ(llVec.at(3), 9);
+}
+
+TEST_F(VectorTest, test_serializer) {
+    // strings of varying lengths; the test block size holds 1 string
+    pc2l::Vector<std::string> strVec;
+    std::vector<std::string> expected;
+    for (int i = 0; i < 40; i++) {
+        const std::string str(i % 7, 'a' + i % 26);
+        strVec.push_back(str);
+        expected.push_back(str);
+    }
+    ASSERT_EQ(strVec.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        ASSERT_EQ(strVec.at(i), expected[i]);
+    }
+    strVec.replace(5, "a much longer string than before");
+    expected[5] = "a much longer string than before";
+    strVec.insert(3, "inserted");
+    expected.insert(expected.begin() + 3, "inserted");
+    strVec.erase(10, 20);
+    expected.erase(expected.begin() + 10, expected.begin() + 20);
+    ASSERT_EQ(strVec.size(), expected.size());
+    ASSERT_TRUE(std::equal(strVec.begin(), strVec.end(), expected.begin()));
+    // several values per block, with the tail block partially filled
+    std::vector<std::vector<int>> vecs;
+    for (int i = 0; i < 23; i++) {
+        vecs.push_back(std::vector<int>(i, i));
+    }
+    pc2l::Vector<std::vector<int>, 4> vecVec(vecs);
+    vecVec.push_back({1, 2, 3});
+    vecs.push_back({1, 2, 3});
+    vecVec.erase(0, 6);
+    vecs.erase(vecs.begin(), vecs.begin() + 6);
+    const std::vector<std::vector<int>> head(vecs.begin(), vecs.begin() + 5);
+    vecVec.insert(2, head.data(), head.size());
+    vecs.insert(vecs.begin() + 2, head.begin(), head.end());
+    ASSERT_EQ(vecVec.size(), vecs.size());
+    for (size_t i = 0; i < vecs.size(); i++) {
+        ASSERT_EQ(vecVec[i], vecs[i]);
+    }
+    vecVec.erase(10, vecVec.size());
+    vecVec.push_back({7});
+    ASSERT_EQ(vecVec.size(), 11);
+    ASSERT_EQ(vecVec.at(10), std::vector<int>(1, 7));
+    ASSERT_THROW(vecVec.at(11), pc2l::Exception);
+}
+
+TEST_F(VectorTest, test_bit_vector) {
+    // 128 bits per block with the test block size
+    pc2l::Vector<bool> bits;
+    std::vector<bool> expected;
+    for (int i = 0; i < 300; i++) {
+        bits.push_back(i % 3 == 0);
+        expected.push_back(i % 3 == 0);
+    }
+    ASSERT_EQ(bits.size(), 300);
+    ASSERT_EQ(bits.count(), 100);
+    bits[1] = true;
+    bits.replace(3, false);
+    expected[1] = true;
+    expected[3] = false;
+    // whole blocks are filled lazily, the partial ones directly
+    bits.set(100, 290, true);
+    std::fill(expected.begin() + 100, expected.begin() + 290, true);
+    bits.resize(1000, true);
+    expected.resize(1000, true);
+    bits.resize(700);
+    expected.resize(700);
+    for (size_t i = 0; i < expected.size(); i++) {
+        ASSERT_EQ(bits.at(i), expected[i]);
+    }
+    ASSERT_EQ(bits.count(), std::count(expected.begin(), expected.end(), true));
+    // word-level operations with another vector of the same size
+    std::vector<bool> mask(700);
+    for (size_t i = 0; i < mask.size(); i++) {
+        mask[i] = (i % 5 == 0) || (i > 600);
+    }
+    pc2l::Vector<bool> other(mask);
+    bits &= other;
+    for (size_t i = 0; i < expected.size(); i++) {
+        expected[i] = expected[i] && mask[i];
+    }
+    ASSERT_EQ(bits.count(), std::count(expected.begin(), expected.end(), true));
+    bits ^= other;
+    bits |= other;
+    ASSERT_EQ(bits.count(), std::count(mask.begin(), mask.end(), true));
+    for (size_t i = 0; i < mask.size(); i++) {
+        ASSERT_EQ(bits[i], mask[i]);
+    }
+    ASSERT_THROW(bits &= pc2l::Vector<bool>(), pc2l::Exception);
+}
+
+TEST_F(VectorTest, test_copy) {
+    pc2l::Vector<int> intVec;
+    for (int i = 0; i < 53; i++) {
+        intVec.push_back(i);
+    }
+    intVec.resize(80, 7);
+    // the copy is made by the workers, including the lazily filled
+    // blocks and the partially filled tail block
+    pc2l::Vector<int> copy(intVec);
+    intVec[2] = -2;
+    intVec.push_back(-1);
+    copy.push_back(1000);
+    ASSERT_EQ(copy.size(), 81);
+    ASSERT_EQ(intVec.size(), 81);
+    for (int i = 0; i < 80; i++) {
+        ASSERT_EQ(copy.at(i), (i < 53) ? i : 7);
+    }
+    ASSERT_EQ(copy.at(80), 1000);
+    ASSERT_EQ(intVec.at(2), -2);
+    ASSERT_EQ(intVec.at(80), -1);
+    // assignment replaces the previous blocks
+    copy = intVec;
+    intVec.clear();
+    ASSERT_EQ(copy.size(), 81);
+    ASSERT_EQ(copy.at(2), -2);
+    ASSERT_EQ(copy.at(80), -1);
+    // variable-length values and bits
+    pc2l::Vector<std::string> strVec;
+    strVec.push_back("one");
+    strVec.push_back("two");
+    pc2l::Vector<std::string> strCopy = strVec;
+    strVec.replace(0, "changed");
+    ASSERT_EQ(strCopy.size(), 2);
+    ASSERT_EQ(strCopy.at(0), "one");
+    ASSERT_EQ(strCopy.at(1), "two");
+    pc2l::Vector<bool> bits;
+    bits.resize(500, true);
+    pc2l::Vector<bool> bitsCopy(bits);
+    bits.set(0, 500, false);
+    ASSERT_EQ(bitsCopy.count(), 500);
+    ASSERT_EQ(bits.count(), 0);
+}
+
+TEST_F(VectorTest, test_search) {
+    pc2l::Vector<int> intVec;
+    for (int i = 0; i < 97; i++) {
+        intVec.push_back(i % 10);
+    }
+    intVec[42] = -3;
+    ASSERT_EQ(pc2l::find(intVec, 7), 7);
+    ASSERT_EQ(pc2l::find(intVec, -3), 42);
+    ASSERT_EQ(pc2l::find(intVec, 11), intVec.size());
+    ASSERT_EQ(pc2l::count(intVec, 6), 10);
+    ASSERT_EQ(pc2l::count(intVec, 2), 9);
+    ASSERT_EQ(pc2l::find_if(intVec, negativeKernel), 42);
+    ASSERT_EQ(pc2l::count_if(intVec, negativeKernel), 1);
+    ASSERT_TRUE(pc2l::any_of(intVec, negativeKernel));
+    intVec.replace(42, 2);
+    ASSERT_FALSE(pc2l::any_of(intVec, negativeKernel));
+    // lazily filled blocks are searched too
+    intVec.resize(150, -1);
+    ASSERT_EQ(pc2l::find_if(intVec, negativeKernel), 97);
+    ASSERT_EQ(pc2l::count_if(intVec, negativeKernel), 53);
+    ASSERT_EQ(pc2l::count(intVec, 2), 10);
+    ASSERT_THROW(pc2l::find_if(intVec, squareKernel), pc2l::Exception);
+    pc2l::Vector<int> empty;
+    ASSERT_EQ(pc2l::find(empty, 0), 0);
+    ASSERT_FALSE(pc2l::any_of(empty, negativeKernel));
+}
+
+// A uniquely named temporary directory that is removed, along with
+// the files in it, when it goes out of scope
+struct TempDir {
+    TempDir() {
+        char name[] = "/tmp/pc2l_test_XXXXXX";
+        if (::mkdtemp(name) != nullptr) {
+            path = name;
+        }
+    }
+    ~TempDir() {
+        DIR* dir = ::opendir(path.c_str());
+        if (dir == nullptr) {
+            return;
+        }
+        for (dirent* entry = ::readdir(dir); entry != nullptr;
+             entry = ::readdir(dir)) {
+            const std::string file = entry->d_name;
+            if (file != "." && file != "..") {
+                std::remove((path + "/" + file).c_str());
+            }
+        }
+        ::closedir(dir);
+        ::rmdir(path.c_str());
+    }
+    std::string path;
+};
+
+TEST_F(VectorTest, test_save_open) {
+    TempDir saved;
+    ASSERT_FALSE(saved.path.empty());
+    pc2l::Vector<int> intVec;
+    for (int i = 0; i < 77; i++) {
+        intVec.push_back(i * 3);
+    }
+    intVec.resize(120, -5);
+    intVec.save(saved.path);
+    intVec.clear();
+    // the opened vector is backed by the files until it is modified
+    pc2l::Vector<int> opened = pc2l::Vector<int>::open(saved.path);
+    ASSERT_EQ(opened.size(), 120);
+    for (int i = 0; i < 120; i++) {
+        ASSERT_EQ(opened.at(i), (i < 77) ? i * 3 : -5);
+    }
+    opened[0] = 42;
+    opened.push_back(7);
+    ASSERT_EQ(pc2l::count(opened, -5), 43);
+    ASSERT_EQ(pc2l::find(opened, 7), 120);
+    ASSERT_EQ(opened.at(0), 42);
+    ASSERT_THROW(pc2l::Vector<long long>::open(saved.path), pc2l::Exception);
+    ASSERT_THROW(pc2l::Vector<int>::open(saved.path + "/missing"),
+                 pc2l::Exception);
+}
+
+TEST_F(VectorTest, test_async) {
+    pc2l::Vector<int> intVec;
+    for (int i = 0; i < 100; i++) {
+        intVec.push_back(i);
+    }
+    // several requests in flight, waited for together
+    std::vector<pc2l::Future<int>> values;
+    for (int i : {3, 47, 91, 12}) {
+        values.push_back(intVec.atAsync(i));
+    }
+    ASSERT_EQ(values[0].get(), 3);
+    ASSERT_EQ(values[1].get(), 47);
+    ASSERT_EQ(values[2].get(), 91);
+    ASSERT_EQ(values[3].get(), 12);
+    // more requests than blocks fit in the cache are still correct
+    std::vector<pc2l::Future<int>> many;
+    for (int i = 0; i < 100; i += 7) {
+        many.push_back(intVec.atAsync(i));
+    }
+    for (size_t i = 0; i < many.size(); i++) {
+        ASSERT_EQ(many[i].get(), i * 7);
+    }
+    pc2l::Future<pc2l::MessagePtr> block = intVec.fetchBlockAsync(10);
+    while (!block.ready()) {}
+    ASSERT_EQ(block.get()->blockTag, 10);
+    // replacements of values whose blocks are not cached are patched
+    // on the workers
+    for (int i = 0; i < 100; i += 9) {
+        ASSERT_TRUE(intVec.replaceAsync(i, -i).ready());
+    }
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(intVec.at(i), (i % 9 == 0) ? -i : i);
+    }
+    // indices past the end fail like at() and replace(), even inside
+    // the last block
+    ASSERT_THROW(intVec.atAsync(100), pc2l::Exception);
+    ASSERT_THROW(intVec.replaceAsync(100, 1), pc2l::Exception);
+    ASSERT_THROW(intVec.replaceAsync(100000, 1), pc2l::Exception);
+}
+
+TEST_F(VectorTest, test_gather_scatter) {
+    pc2l::Vector<long long> llVec;
+    for (int i = 0; i < 101; i++) {
+        llVec.push_back(i * 10);
+    }
+    // indices spread over all blocks, including the tail block, with
+    // duplicates and in no particular order
+    const std::vector<unsigned long long> indices = {99, 3, 100, 57, 3, 0, 64, 31};
+    std::vector<long long> values = llVec.gather(indices);
+    ASSERT_EQ(values.size(), indices.size());
+    for (size_t i = 0; i < indices.size(); i++) {
+        ASSERT_EQ(values[i], indices[i] * 10);
+    }
+    for (long long& val : values) {
+        val = -val;
+    }
+    llVec.scatter(indices, values);
+    for (int i = 0; i < 101; i++) {
+        const bool scattered = std::find(indices.begin(), indices.end(), i) !=
+            indices.end();
+        ASSERT_EQ(llVec.at(i), scattered ? -i * 10 : i * 10);
+    }
+    ASSERT_EQ(llVec.gather(indices), values);
+    ASSERT_TRUE(llVec.gather({}).empty());
+    ASSERT_THROW(llVec.gather({101}), pc2l::Exception);
+    ASSERT_THROW(llVec.scatter({1, 2}, {5}), pc2l::Exception);
+}
+
+TEST_F(VectorTest, test_codec) {
+    // Encoding shrinks compressible blocks and decodes exactly,
+    // including the bytes after the last whole value
+    for (int codec : {pc2l::BlockCodec::DELTA, pc2l::BlockCodec::SHUFFLE_RLE}) {
+        pc2l::MessagePtr block = pc2l::Message::create(4 * 100 + 3,
+                                                       pc2l::Message::STORE_BLOCK);
+        int* ints = reinterpret_cast<int*>(block->getPayload());
+        for (int i = 0; i < 100; i++) {
+            ints[i] = 1000 + i * 7 - (i % 3);
+        }
+        std::fill_n(block->getPayload() + 400, 3, 'x');
+        pc2l::MessagePtr encoded = pc2l::BlockCodec::encodeBlock(block, codec, 4);
+        ASSERT_EQ(encoded->tag, pc2l::Message::ENCODED_BLOCK);
+        ASSERT_LT(encoded->getPayloadSize(), block->getPayloadSize());
+        pc2l::MessagePtr decoded = pc2l::BlockCodec::decodeBlock(encoded);
+        ASSERT_EQ(decoded->getPayloadSize(), block->getPayloadSize());
+        ASSERT_TRUE(std::equal(block->getPayload(), block->getPayload() + 403,
+                               decoded->getPayload()));
+    }
+    // Blocks are encoded on the way to the workers (64 values per
+    // block, so every block is evicted) and decoded on the way back
+    // or when the workers operate on them
+    pc2l::Vector<int, 64> ints;
+    ints.setCodec(pc2l::BlockCodec::DELTA);
+    for (int i = 0; i < 1000; i++) {
+        ints.push_back((i % 100 == 0) ? -i * 10 : i);
+    }
+    ints.push_back(std::numeric_limits<int>::max());
+    ints.push_back(std::numeric_limits<int>::min());
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_EQ(ints.at(i), (i % 100 == 0) ? -i * 10 : i);
+    }
+    ASSERT_EQ(ints.at(1000), std::numeric_limits<int>::max());
+    ASSERT_EQ(ints.at(1001), std::numeric_limits<int>::min());
+    ints.resize(1000);
+    // Operations that only read the blocks leave them encoded
+    ASSERT_EQ(pc2l::count(ints, 7), 1);
+    ASSERT_EQ(pc2l::reduce(ints, 0, maxKernel), 999);
+    ASSERT_EQ(ints.gather({7, 700, 999, 8}), std::vector<int>({7, -7000, 999, 8}));
+    pc2l::Vector<int, 64> copy = ints;
+    pc2l::transform(ints, squareKernel);
+    ASSERT_EQ(pc2l::find(ints, 49), 7);
+    for (int i = 1; i < 1000; i += 37) {
+        ASSERT_EQ(ints.at(i), (i % 100 == 0) ? i * i * 100 : i * i);
+        ASSERT_EQ(copy.at(i), (i % 100 == 0) ? -i * 10 : i);
+    }
+    pc2l::Vector<double, 64> doubles;
+    doubles.setCodec(pc2l::BlockCodec::SHUFFLE_RLE);
+    for (int i = 0; i < 500; i++) {
+        doubles.push_back(i * 0.5);
+    }
+    ASSERT_EQ(doubles.gather({499, 0, 250}), std::vector<double>({249.5, 0, 125}));
+    for (int i = 0; i < 500; i++) {
+        ASSERT_EQ(doubles.at(i), i * 0.5);
+    }
+    ASSERT_THROW(doubles.setCodec(42), pc2l::Exception);
+}
+
+TEST_F(VectorTest, test_dirty_ranges) {
+    pc2l::Vector<int> intVec;
+    for (int i = 0; i < 100; i++) {
+        intVec.push_back(i);
+    }
+    // Reading every block leaves clean blocks in the cache, which are
+    // dropped on eviction. Small changes are written back as patches.
+    ASSERT_EQ(std::accumulate(intVec.cbegin(), intVec.cend(), 0), 4950);
+    for (int i = 3; i < 100; i += 10) {
+        intVec.replace(i, -i);
+    }
+    intVec[51] = 1000;
+    intVec[52] += 1;
+    auto it = intVec.begin() + 70;
+    *it = 7000;
+    intVec.replaceAsync(98, 9800).get();
+    for (int i = 0; i < 100; i++) {
+        const int expected = (i == 51) ? 1000 : (i == 52) ? 53 : (i == 70) ? 7000 :
+            (i == 98) ? 9800 : (i % 10 == 3) ? -i : i;
+        ASSERT_EQ(intVec.at(i), expected);
+    }
+    // The patches reach the workers before they operate on the blocks
+    ASSERT_EQ(pc2l::reduce(intVec, 0, maxKernel), 9800);
+    ASSERT_EQ(pc2l::count(intVec, -93), 1);
+    // A block written back while an iterator holds it stays dirty
+    it = intVec.begin();
+    *it = 1;
+    ASSERT_EQ(pc2l::count(intVec, 1), 2);
+    *it = 2;
+    it = intVec.end();
+    for (int i = 5; i < 100; i++) {
+        intVec.at(i);
+    }
+    ASSERT_EQ(intVec.at(0), 2);
+    pc2l::Vector<bool> bits;
+    bits.resize(1000);
+    for (int i = 0; i < 1000; i += 7) {
+        bits[i] = true;
+    }
+    for (int i = 0; i < 1000; i += 49) {
+        bits[i].flip();
+    }
+    ASSERT_EQ(bits.count(), 143 - 21);
+    ASSERT_TRUE(bits.at(14) && !bits.at(49) && !bits.at(15));
+}
+
+TEST_F(VectorTest, test_write_policies) {
+    auto& cm = pc2l::System::get().cacheManager();
+    pc2l::Vector<int> hot;
+    for (int i = 0; i < 5; i++) {
+        hot.push_back(i);
+    }
+    ASSERT_EQ(hot.at(4), 4);
+    const size_t hotKey = cm.getKey(hot.dsTag, 0);
+    // Loading with write-around does not evict the blocks in use
+    pc2l::Vector<int> bulk;
+    bulk.setWritePolicy(pc2l::CacheManager::WRITE_AROUND);
+    for (int i = 0; i < 200; i++) {
+        bulk.push_back(i);
+    }
+    bulk.flush();
+    bulk.replace(7, -7);
+    ASSERT_TRUE(cm.managerCache().find(hotKey) != cm.managerCache().end());
+    for (const auto& entry : cm.managerCache()) {
+        ASSERT_NE(entry.second->dsTag, bulk.dsTag);
+    }
+    for (int i = 0; i < 200; i++) {
+        ASSERT_EQ(bulk.at(i), (i == 7) ? -7 : i);
+    }
+    // Copies keep the policy
+    pc2l::Vector<int> copy = bulk;
+    copy.replace(150, 5);
+    ASSERT_EQ(cm.managerCache().find(cm.getKey(copy.dsTag, 30)),
+              cm.managerCache().end());
+    ASSERT_EQ(copy.at(150), 5);
+    ASSERT_EQ(bulk.at(150), 150);
+    // Write-through keeps the written blocks cached
+    pc2l::Vector<int> through;
+    through.setWritePolicy(pc2l::CacheManager::WRITE_THROUGH);
+    for (int i = 0; i < 50; i++) {
+        through.push_back(i);
+    }
+    through.flush();
+    through.replace(3, 300);
+    ASSERT_TRUE(cm.managerCache().find(cm.getKey(through.dsTag, 0)) !=
+                cm.managerCache().end());
+    *(through.begin() + 10) = 1000;
+    ASSERT_EQ(pc2l::reduce(through, 0, maxKernel), 1000);
+    ASSERT_EQ(through.at(3), 300);
+    // Writes through an iterator after a write-back are not lost,
+    // whatever the policy
+    for (auto policy : {pc2l::CacheManager::WRITE_BACK,
+                        pc2l::CacheManager::WRITE_THROUGH,
+                        pc2l::CacheManager::WRITE_AROUND}) {
+        pc2l::Vector<int> intVec;
+        intVec.setWritePolicy(policy);
+        for (int i = 0; i < 50; i++) {
+            intVec.push_back(i);
+        }
+        auto it = intVec.begin();
+        *it = 100;
+        ASSERT_EQ(pc2l::reduce(intVec, 0, maxKernel), 100);
+        *it = 200;
+        intVec.replace(1, -1);
+        ++it;
+        *++it = 300;
+        it = intVec.end();
+        for (int i = 5; i < 50; i++) {
+            intVec.at(i);
+        }
+        ASSERT_EQ(intVec.at(0), 200);
+        ASSERT_EQ(intVec.at(1), -1);
+        ASSERT_EQ(intVec.at(2), 300);
+    }
+}
+
+// Count the hits of a cache holding 3 blocks over a sequence of accesses
+static int
+countHits(pc2l::EvictionPolicy& policy, const std::vector<size_t>& keys) {
+    std::vector<size_t> cached;
+    int hits = 0;
+    for (const size_t key : keys) {
+        if (std::find(cached.begin(), cached.end(), key) != cached.end()) {
+            policy.access(key);
+            hits++;
+            continue;
+        }
+        size_t victim;
+        if (cached.size() == 3 &&
+            policy.evict(key, [](size_t) { return true; }, victim)) {
+            cached.erase(std::find(cached.begin(), cached.end(), victim));
+        }
+        policy.insert(key);
+        cached.push_back(key);
+    }
+    return hits;
+}
+
+TEST_F(VectorTest, test_eviction_policies) {
+    pc2l::RecencyPolicy lru(false), mru(true);
+    pc2l::LfuPolicy lfu;
+    pc2l::ClockPolicy clock;
+    for (pc2l::EvictionPolicy* policy : std::vector<pc2l::EvictionPolicy*>{
+            &lru, &mru, &lfu, &clock}) {
+        for (size_t key = 1; key <= 3; key++) {
+            policy->insert(key);
+        }
+        policy->access(1);
+    }
+    lfu.access(1);
+    lfu.access(3);
+    const auto any = [](size_t) { return true; };
+    size_t victim;
+    ASSERT_TRUE(lru.evict(4, any, victim));
+    ASSERT_EQ(victim, 2);
+    ASSERT_TRUE(mru.evict(4, any, victim));
+    ASSERT_EQ(victim, 1);
+    ASSERT_TRUE(lfu.evict(4, any, victim));
+    ASSERT_EQ(victim, 2);
+    ASSERT_TRUE(clock.evict(4, any, victim));
+    ASSERT_EQ(victim, 2);
+    // Pinned blocks are skipped and erased blocks are forgotten
+    ASSERT_TRUE(lru.evict(4, [](size_t key) { return key != 3; }, victim));
+    ASSERT_EQ(victim, 1);
+    lru.erase(3);
+    ASSERT_FALSE(lru.evict(4, any, victim));
+    ASSERT_FALSE(clock.evict(4, [](size_t) { return false; }, victim));
+    // Cyclic scans over more blocks than the cache holds defeat LRU
+    std::vector<size_t> cyclic;
+    for (int i = 0; i < 80; i++) {
+        cyclic.push_back(i % 4);
+    }
+    pc2l::RecencyPolicy loopLru(false), loopMru(true);
+    pc2l::ClockPolicy loopClock;
+    ASSERT_EQ(countHits(loopLru, cyclic), 0);
+    ASSERT_EQ(countHits(loopClock, cyclic), 0);
+    ASSERT_GT(countHits(loopMru, cyclic), 40);
+    // A one-time scan does not flush blocks used repeatedly from ARC
+    std::vector<size_t> scan = {100, 101, 100, 101};
+    for (size_t key = 0; key < 10; key++) {
+        scan.push_back(key);
+    }
+    scan.push_back(100);
+    scan.push_back(101);
+    pc2l::RecencyPolicy scanLru(false);
+    pc2l::ArcPolicy scanArc;
+    ASSERT_EQ(countHits(scanLru, scan), 2);
+    ASSERT_EQ(countHits(scanArc, scan), 4);
+    // The values are intact whichever blocks the manager evicts
+    auto& pc2l = pc2l::System::get();
+    for (auto strategy : {pc2l::CacheWorker::MRU, pc2l::CacheWorker::LFU,
+                          pc2l::CacheWorker::CLOCK, pc2l::CacheWorker::ARC,
+                          pc2l::CacheWorker::LRU}) {
+        pc2l.setEvictionStrategy(strategy);
+        ASSERT_EQ(pc2l.cacheManager().getEvictionStrategy(), strategy);
+        pc2l::Vector<int> intVec;
+        for (int i = 0; i < 40; i++) {
+            intVec.push_back(i);
+        }
+        for (int round = 0; round < 3; round++) {
+            for (int i = round; i < 40; i += 3) {
+                intVec.replace(i, intVec.at(i) + 1);
+            }
+        }
+        for (int i = 0; i < 40; i++) {
+            ASSERT_EQ(intVec.at(i), i + 1);
+        }
+    }
+}
+
+TEST_F(VectorTest, test_cache_bytes) {
+    auto& pc2l = pc2l::System::get();
+    auto& cm = pc2l.cacheManager();
+    const auto residentBytes = [&cm]() {
+        unsigned long long bytes = 0;
+        for (const auto& entry : cm.managerCache()) {
+            bytes += entry.second->getSize();
+        }
+        return bytes;
+    };
+    // Blocks of 3 different sizes share the cache
+    pc2l::Vector<int> small, big(10 * sizeof(int));
+    pc2l::Vector<char> tiny(4);
+    for (int i = 0; i < 40; i++) {
+        small.push_back(i);
+        big.push_back(-i);
+        tiny.push_back('a' + i % 26);
+        ASSERT_EQ(cm.getCachedBytes(), residentBytes());
+        ASSERT_LE(cm.getCachedBytes(), cm.cacheSize);
+    }
+    // A big block needs more than one small block evicted to fit
+    small.at(0);
+    small.at(10);
+    small.at(20);
+    ASSERT_EQ(cm.managerCache().size(), 3);
+    big.at(0);
+    ASSERT_LE(cm.managerCache().size(), 2);
+    ASSERT_LE(cm.getCachedBytes(), cm.cacheSize);
+    ASSERT_EQ(cm.getCachedBytes(), residentBytes());
+    for (int i = 0; i < 40; i++) {
+        ASSERT_EQ(small.at(i), i);
+        ASSERT_EQ(big.at(i), -i);
+        ASSERT_EQ(tiny.at(i), 'a' + i % 26);
+    }
+    ASSERT_EQ(cm.getCachedBytes(), residentBytes());
+}
+
 /*TEST_F(VectorTest, test_caching) {
     // Test caching on the vector
     for (int i = 0; i < 100; i++) {